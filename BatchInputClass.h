@@ -0,0 +1,109 @@
+#ifndef BATCHINPUTCLASS_H
+#define BATCHINPUTCLASS_H
+
+#include "ClientClass.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Size of single read when input cant be mapped (pipe)
+#define BATCH_READ_CHUNK (1 << 20)
+
+// Scripted user input read and parsed as a whole before the session starts. Commands are passed to client
+// without waiting for each one to be sent, only number of outstanding messages is bounded. Client itself
+// still holds everything behind AUTH/JOIN till its REPLY comes, so replies keep their order
+class BatchInputClass {
+    public:
+        BatchInputClass ()
+        : mapped            (nullptr),
+          mapped_size       (0),
+          next              (0),
+          last_unterminated (false)
+        {
+        }
+        ~BatchInputClass () {
+            if (this->mapped != nullptr)
+                munmap(this->mapped, this->mapped_size);
+        }
+
+        // Reads and parses given file ("-" for stdin), regular file is mapped instead of copied. False if it cant be read
+        bool load (const std::string& path) {
+            int fd = (path == "-") ? STDIN_FILENO : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return false;
+
+            struct stat info;
+            if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+                void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED) {
+                    madvise(data, info.st_size, MADV_SEQUENTIAL);
+                    this->mapped = data;
+                    this->mapped_size = info.st_size;
+                }
+            }
+            bool read_ok = (this->mapped != nullptr) || read_whole(fd);
+            // Mapping stays valid once file is closed
+            if (fd != STDIN_FILENO)
+                close(fd);
+            if (read_ok == false)
+                return false;
+
+            if (this->mapped != nullptr)
+                parse(std::string_view(static_cast<const char*>(this->mapped), this->mapped_size));
+            else
+                parse(this->buffer);
+            return true;
+        }
+        // Passes next commands to client while it has fewer than limit messages outstanding
+        void feed (ClientClass* client, uint32_t limit) {
+            while (done() == false && client->stop_program() == false && client->outstanding() < limit) {
+                bool last_line = (this->next + 1 == this->commands.size() && this->last_unterminated == true);
+                client->run_user_command(this->commands[this->next++], last_line);
+            }
+        }
+        // Returns true once all commands were passed to client
+        bool done () {
+            return this->next >= this->commands.size();
+        }
+
+    private:
+        void* mapped;
+        size_t mapped_size;
+        // Input read from pipe, commands point into it
+        std::string buffer;
+        std::vector<UserCommand> commands;
+        size_t next;
+        // Input doesnt end with line ending, its last line is handled like at EOF of interactive input
+        bool last_unterminated;
+
+        bool read_whole (int fd) {
+            while (true) {
+                size_t used = this->buffer.size();
+                this->buffer.resize(used + BATCH_READ_CHUNK);
+                ssize_t bytes_read = read(fd, this->buffer.data() + used, BATCH_READ_CHUNK);
+                this->buffer.resize(used + std::max<ssize_t>(bytes_read, 0));
+                if (bytes_read < 0 && errno == EINTR)
+                    continue;
+                if (bytes_read <= 0)
+                    return (bytes_read == 0);
+            }
+        }
+        void parse (std::string_view input) {
+            size_t line_start = 0;
+            while (line_start < input.size()) {
+                size_t line_end = input.find('\n', line_start);
+                if (line_end == std::string_view::npos) {
+                    this->last_unterminated = true;
+                    line_end = input.size();
+                }
+                UserCommand command = ClientClass::parse_user_line(input.substr(line_start, line_end - line_start));
+                // Empty lines are skipped by client anyway
+                if (command.kind != U_NONE)
+                    this->commands.push_back(command);
+                line_start = line_end + 1;
+            }
+        }
+};
+
+#endif // BATCHINPUTCLASS_H
\ No newline at end of file
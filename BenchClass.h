@@ -0,0 +1,153 @@
+#ifndef BENCHCLASS_H
+#define BENCHCLASS_H
+
+#include "ConstsFile.h"
+
+#include <fstream>
+
+// Number of heap allocations made so far, counted by replaced global operator new of benchmark program
+inline std::atomic<uint64_t> bench_allocations = 0;
+
+// Result of single benchmark case
+typedef struct {
+    std::string name;
+    uint64_t ops;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_sec;
+} BenchResult;
+
+// Runs benchmark cases, outputs their results and compares them with results of previous run
+class BenchClass {
+    public:
+        BenchClass (std::chrono::milliseconds min_time)
+        : min_time (min_time)
+        {
+        }
+
+        // Calls operation for indexes 0..inputs_count-1 over and over for at least min_time,
+        // pass_bytes is number of bytes processed by one pass over all inputs.
+        // Time is split into samples and the fastest one is reported, it is least disturbed by the rest of the system
+        template <typename Operation>
+        void run (const std::string& name, size_t inputs_count, size_t pass_bytes, Operation operation) {
+            measure(name, inputs_count, 1, pass_bytes, operation);
+        }
+        // Calls operation doing whole round of round_ops operations at once (e.g. among several threads) over and over,
+        // results are reported per single operation of the round
+        template <typename Operation>
+        void run_rounds (const std::string& name, size_t round_ops, Operation operation) {
+            measure(name, 1, round_ops, 0, [&](size_t) {
+                operation();
+            });
+        }
+        // Keeps compiler from dropping computation whose result is otherwise unused
+        template <typename Value>
+        static void keep (const Value& value) {
+            asm volatile("" : : "r"(&value) : "memory");
+        }
+        // Writes results as JSON object per line
+        bool write_results (const std::string& path) {
+            std::ofstream file(path);
+            for (const BenchResult& result : this->results) {
+                char line[256];
+                snprintf(line, sizeof(line), "{\"case\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"bytes_per_sec\":%.0f}",
+                         result.name.c_str(), static_cast<unsigned long long>(result.ops), result.ns_per_op,
+                         result.allocs_per_op, result.bytes_per_sec);
+                file << line << '\n';
+            }
+            return file.good();
+        }
+        // Compares results with ones written by previous run, returns false if some case got slower by more
+        // than threshold percent or started allocating more
+        bool compare (const std::string& path, double threshold) {
+            std::ifstream file(path);
+            if (file.is_open() == false) {
+                OutputClass::out_err_intern("Cannot open baseline results");
+                return false;
+            }
+            bool passed = true;
+            std::string line;
+            while (std::getline(file, line)) {
+                BenchResult baseline;
+                if (parse_result(line, baseline) == false)
+                    continue;
+                auto current = std::find_if(this->results.begin(), this->results.end(), [&](const BenchResult& result) {
+                    return result.name == baseline.name;
+                });
+                if (current == this->results.end())
+                    continue;
+
+                double change = (current->ns_per_op / baseline.ns_per_op - 1.0) * 100.0;
+                bool regressed = change > threshold || current->allocs_per_op > baseline.allocs_per_op + 0.001;
+                char out_line[256];
+                snprintf(out_line, sizeof(out_line), "%-28s %10.2f -> %10.2f ns/op %+7.1f %%  %6.3f -> %6.3f allocs/op%s",
+                         baseline.name.c_str(), baseline.ns_per_op, current->ns_per_op, change,
+                         baseline.allocs_per_op, current->allocs_per_op, (regressed ? "  REGRESSION" : ""));
+                OutputClass::out_line(out_line);
+                passed = passed && (regressed == false);
+            }
+            return passed;
+        }
+
+    private:
+        static constexpr size_t SAMPLES = 5;
+
+        std::chrono::milliseconds min_time;
+        std::vector<BenchResult> results;
+
+        template <typename Operation>
+        void measure (const std::string& name, size_t inputs_count, size_t ops_per_call, size_t pass_bytes, Operation operation) {
+            // Warm up caches and let lazily allocated buffers settle
+            for (size_t index = 0; index < inputs_count; ++index)
+                operation(index);
+
+            uint64_t passes = 0;
+            uint64_t allocs_start = bench_allocations.load(std::memory_order_relaxed);
+            double best_ns_per_op = 0;
+            for (size_t sample = 0; sample < SAMPLES; ++sample) {
+                uint64_t sample_passes = 0;
+                auto start = std::chrono::steady_clock::now();
+                auto elapsed = std::chrono::steady_clock::duration::zero();
+                do {
+                    for (size_t index = 0; index < inputs_count; ++index)
+                        operation(index);
+                    ++sample_passes;
+                    elapsed = std::chrono::steady_clock::now() - start;
+                } while (elapsed < this->min_time / SAMPLES);
+
+                double ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / (sample_passes * inputs_count * ops_per_call);
+                if (sample == 0 || ns_per_op < best_ns_per_op)
+                    best_ns_per_op = ns_per_op;
+                passes += sample_passes;
+            }
+            uint64_t allocs = bench_allocations.load(std::memory_order_relaxed) - allocs_start;
+
+            uint64_t ops = passes * inputs_count * ops_per_call;
+            this->results.push_back({
+                name, ops, best_ns_per_op, static_cast<double>(allocs) / ops, pass_bytes / (best_ns_per_op * inputs_count * ops_per_call) * 1e9
+            });
+            print(this->results.back());
+        }
+        static void print (const BenchResult& result) {
+            char line[256];
+            snprintf(line, sizeof(line), "%-28s %12llu ops %10.2f ns/op %8.3f allocs/op %10.1f MB/s",
+                     result.name.c_str(), static_cast<unsigned long long>(result.ops), result.ns_per_op,
+                     result.allocs_per_op, result.bytes_per_sec / 1e6);
+            OutputClass::out_line(line);
+        }
+        // Reads line written by write_results, false if it isnt one
+        static bool parse_result (const std::string& line, BenchResult& result) {
+            size_t name_start = line.find("\"case\":\"");
+            size_t ns_start = line.find("\"ns_per_op\":");
+            size_t allocs_start = line.find("\"allocs_per_op\":");
+            if (name_start == std::string::npos || ns_start == std::string::npos || allocs_start == std::string::npos)
+                return false;
+            name_start += 8;
+            result.name = line.substr(name_start, line.find('"', name_start) - name_start);
+            result.ns_per_op = std::strtod(line.c_str() + ns_start + 12, nullptr);
+            result.allocs_per_op = std::strtod(line.c_str() + allocs_start + 16, nullptr);
+            return result.ns_per_op > 0;
+        }
+};
+
+#endif // BENCHCLASS_H
\ No newline at end of file
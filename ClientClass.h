@@ -2,55 +2,107 @@
 #define CLIENTCLASS_H
 
 #include "ConstsFile.h"
+#include "ValidatorClass.h"
+#include "MessageClass.h"
+#include "MessagePoolClass.h"
+#include "MetricsClass.h"
+#include "UringClass.h"
+#include "SendQueueClass.h"
+#include "SessionTaskClass.h"
 
-// Regex patterns for message values check
-const regex username_pattern     ("^[A-z0-9-]{1,20}$");
-const regex channel_id_pattern   ("^[A-z0-9-.]{1,20}$");
-const regex secret_pattern       ("^[A-z0-9-]{1,128}$");
-const regex display_name_pattern ("^[\x21-\x7E]{1,20}$");
-const regex message_pattern      ("^[\x20-\x7E]{1,1400}$");
+// Kinds of user input lines
+enum USER_COMMAND : uint8_t {
+    U_NONE = 0, // Empty line
+    U_AUTH,     // /auth {Username} {Secret} {DisplayName}
+    U_JOIN,     // /join {ChannelID}
+    U_RENAME,   // /rename {DisplayName}
+    U_HELP,     // /help
+    U_UNKNOWN,  // Unknown command or wrong number of its params
+    U_MSG       // Anything not starting with '/'
+};
+
+// Parsed user input line, arguments point into the line
+typedef struct {
+    USER_COMMAND kind = U_NONE;
+    // AUTH: user name, display name, secret; JOIN: channel; RENAME: display name; MSG: whole line
+    std::string_view args[3];
+} UserCommand;
 
 class ClientClass {
     public:
         ClientClass ()
         : port            (4567),
           socket_id       (-1),
+          stop_fd         (-1),
           server_hostname (""),
           display_name    (""),
           stop_send       (false),
           stop_recv       (false),
-          high_priority   (false),
           load_input      (false),
+          send_sleeping   (false),
+          priority_taken  (false),
           wait_for_reply  (false),
+          request_id      (0),
           end_program     (false),
-          cur_state       (S_START)
+          use_threads     (true),
+          use_uring       (false),
+          cur_state       (S_START),
+          flow_wait       (W_NONE),
+          reply_deadline  (std::chrono::steady_clock::time_point::max())
         {
         }
 
         virtual ~ClientClass ()
         {
+            if (this->stop_fd >= 0)
+                close(this->stop_fd);
         }
         // Pure virtual methods implemented by both child classes (UDPClass and TCPClass)
         // Tries opening connection (UDP/TCP) and starting support threads for server and user actions handling
-        virtual void open_connection ()                                                              = 0;
+        virtual void open_connection ()                                                                             = 0;
         // Appends BYE message to the client queue of messages being send to server
-        virtual void send_bye ()                                                                     = 0;
-        // Appends BYE message to the client queue of messages being send to server while clearing all other messages from queue to ensure priority sending
-        virtual void send_priority_bye ()                                                            = 0;
-        // Appends AUTH message with provided values to the client queue of messages being send to server
-        virtual void send_auth (std::string user_name, std::string display_name, std::string secret) = 0;
-        // Appends JOIN message with provided value to the client queue of messages being send to server
-        virtual void send_join (std::string channel_id)                                              = 0;
-        // Appends MSG message with provided values to the client queue of messages being send to server
-        virtual void send_msg (std::string msg)                                                      = 0;
+        virtual void send_bye ()                                                                                    = 0;
+        // Appends BYE message to the priority lane of client queue, so it is sent ahead of all other messages
+        virtual void send_priority_bye ()                                                                           = 0;
+        // Appends AUTH message with provided values to the client queue of messages being send to server, false if not appended
+        virtual bool send_auth (std::string_view user_name, std::string_view display_name, std::string_view secret) = 0;
+        // Appends JOIN message with provided value to the client queue of messages being send to server, false if not appended
+        virtual bool send_join (std::string_view channel_id)                                                        = 0;
+        // Appends MSG message with provided values to the client queue of messages being send to server, false if not appended
+        virtual bool send_msg (std::string_view msg)                                                                = 0;
         // Closes the socket, stops running support threads and notifies main with conditional variable
-        virtual void session_end ()                                                                  = 0;
+        virtual void session_end ()                                                                                 = 0;
         // Setter for client display_name attribute
-        virtual bool send_rename (std::string new_display_name)                                      = 0;
+        virtual bool send_rename (std::string new_display_name)                                                     = 0;
+        // Sends all messages which can be sent right now (and handles expired deadlines), used by event loop engine
+        virtual void send_pending ()                                                                                = 0;
+        // Processes all data already waiting on the socket without blocking, used by event loop engine
+        virtual void receive_pending ()                                                                             = 0;
+        // Stores earliest deadline client has to be woken up at, false if there is none
+        virtual bool next_deadline (std::chrono::steady_clock::time_point& deadline) {
+            if (this->reply_deadline == std::chrono::steady_clock::time_point::max())
+                return false;
+            deadline = this->reply_deadline;
+            return true;
+        }
         // Finish executing once both client's threads finished their work
         void wait_for_threads () {
-            this->send_thread.join();
-            this->recv_thread.join();
+            if (this->send_thread.joinable())
+                this->send_thread.join();
+            if (this->recv_thread.joinable())
+                this->recv_thread.join();
+        }
+        // Returns value indicating whether client runs its own support threads or is driven by event loop engine
+        bool threaded () {
+            return this->use_threads;
+        }
+        // Getter for socket used for communication with server
+        int get_socket () {
+            return this->socket_id;
+        }
+        // Getter for event signaled once session ended, blocking waits of support threads watch it beside their fd
+        int get_stop_fd () {
+            return this->stop_fd;
         }
         // Returns value indicating whether child class already closed connection
         bool stop_program () {
@@ -62,46 +114,131 @@ class ClientClass {
         }
         // Setter for attribute indicating whether next user input is allowed to be read
         void set_load_user_input (bool value) {
+            std::lock_guard<std::mutex> lock(this->input_mutex);
             this->load_input = value;
         }
+        // Blocks until client allows loading next user input, then resets it for the next one
+        void wait_for_load_user_input () {
+            std::unique_lock<std::mutex> lock(this->input_mutex);
+            this->input_cond_var.wait(lock, [&] {
+                return this->load_input;
+            });
+            this->load_input = false;
+        }
         // Getter for conditional variable
         std::condition_variable& get_cond_var () {
             return this->cond_var;
         }
-        // Getter for conditional variable
-        std::condition_variable& get_input_cond_var () {
-            return this->input_cond_var;
-        }
-        // Splits given string line into given string vector while using delim as separator
-        void split_to_vec (std::string line, std::vector<std::string>& words_vec, char delim) {
-            // Initially clear vector
-            words_vec.clear();
-
-            // Create string stream from input line
-            std::stringstream ss(line);
-            std::string line_word;
-
-            // Insert each word to vector
-            while(getline(ss, line_word, delim))
-                words_vec.push_back(line_word);
-        }
-        // Return true if given message struct contains valid values, false otherwise
-        template <typename strType>
-        bool check_valid_msg (uint8_t type, strType& data) {
-            switch (type) {
+        // Getter for mutex main function holds while checking its wake up condition
+        std::mutex& get_end_mutex () {
+            return this->end_mutex;
+        }
+        // Wakes main function, taking end_mutex first keeps the wakeup from getting lost
+        void notify_main () {
+            {
+                std::lock_guard<std::mutex> lock(this->end_mutex);
+            }
+            this->cond_var.notify_one();
+        }
+        // Processes single line of user input, returns true when message was appended to be sent and next input has to wait for it
+        bool process_user_line (std::string& user_line, bool last_line) {
+            return run_user_command(parse_user_line(user_line), last_line);
+        }
+        // Splits user input line into command and its params, words are separated by single spaces
+        static UserCommand parse_user_line (std::string_view user_line) {
+            UserCommand command;
+            if (user_line.empty() == true)
+                return command;
+            if (user_line[0] != '/') {
+                command.kind = U_MSG;
+                command.args[0] = user_line;
+                return command;
+            }
+
+            // Space at the very end doesnt start another word. Words past the fourth are only counted
+            std::string_view words[4];
+            size_t words_count = 0;
+            size_t word_start = 0;
+            while (word_start < user_line.size()) {
+                size_t word_end = std::min(user_line.find(' ', word_start), user_line.size());
+                if (words_count < 4)
+                    words[words_count] = user_line.substr(word_start, word_end - word_start);
+                ++words_count;
+                word_start = word_end + 1;
+            }
+
+            command.kind = U_UNKNOWN;
+            if (words[0] == "/auth" && words_count == 4) {
+                command.kind = U_AUTH;
+                command.args[0] = words[1];
+                command.args[1] = words[3];
+                command.args[2] = words[2];
+            }
+            else if (words[0] == "/join" && words_count == 2) {
+                command.kind = U_JOIN;
+                command.args[0] = words[1];
+            }
+            else if (words[0] == "/rename" && words_count == 2) {
+                command.kind = U_RENAME;
+                command.args[0] = words[1];
+            }
+            else if (words[0] == "/help" && words_count == 1)
+                command.kind = U_HELP;
+            return command;
+        }
+        // Runs parsed line of user input, returns true when message was appended to be sent and next input has to wait for it.
+        // Last line of input without line ending is not sent as MSG
+        bool run_user_command (const UserCommand& command, bool last_line) {
+            // Skip empty line
+            if (command.kind == U_NONE)
+                return false;
+            TraceClass::record(T_INPUT);
+
+            switch (command.kind) {
+                case U_AUTH:
+                    return send_auth(command.args[0], command.args[1], command.args[2]);
+                case U_JOIN:
+                    return send_join(command.args[0]);
+                case U_RENAME:
+                    send_rename(std::string(command.args[0]));
+                    return false;
+                case U_HELP:
+                    OutputClass::out_help_cmds();
+                    return false;
+                case U_MSG:
+                    if (last_line == false) // Msg to send
+                        return send_msg(command.args[0]);
+                    return false;
+                default:
+                    if (last_line == false) // Output error and continue
+                        OutputClass::out_err_intern("Unknown command or unsufficinet number of command params provided");
+                    return false;
+            }
+        }
+        // Number of messages appended to be sent and not done with yet (queued, or sent and waiting for CONFIRM)
+        uint32_t outstanding () {
+            return this->pool.in_use();
+        }
+        // Return true if given message contains valid values, false otherwise
+        bool check_valid_msg (const MessageClass& data) {
+            // Some value didnt even fit into the message
+            if (data.overflowed() == true)
+                return false;
+
+            switch (data.type) {
                 case AUTH:
-                    return regex_match(data.user_name, username_pattern) &&
-                           regex_match(data.display_name, display_name_pattern) &&
-                           regex_match(data.secret, secret_pattern);
+                    return ValidatorClass::user_name(data.user_name()) &&
+                           ValidatorClass::display_name(data.display_name()) &&
+                           ValidatorClass::secret(data.secret());
                 case ERR:
                 case MSG:
-                    return regex_match(data.display_name, display_name_pattern) &&
-                           regex_match(data.message, message_pattern);
+                    return ValidatorClass::display_name(data.display_name()) &&
+                           ValidatorClass::message(data.message());
                 case REPLY:
-                    return regex_match(data.message, message_pattern);
+                    return ValidatorClass::message(data.message());
                 case JOIN:
-                    return regex_match(data.channel_id, channel_id_pattern) &&
-                           regex_match(data.display_name, display_name_pattern);
+                    return ValidatorClass::channel_id(data.channel_id()) &&
+                           ValidatorClass::display_name(data.display_name());
                 case BYE:
                 case CONFIRM:
                     return true;
@@ -138,10 +275,325 @@ class ClientClass {
         }
 
     protected:
+        // Allows loading next user input and notifies waiting input thread
+        void allow_user_input () {
+            {
+                std::lock_guard<std::mutex> lock(this->input_mutex);
+                if (this->load_input == false)
+                    TraceClass::record(T_RESUME);
+                this->load_input = true;
+            }
+            this->input_cond_var.notify_one();
+        }
+        // Wakes up send thread after message was queued without holding the lock.
+        // Lock is taken only when send thread may be just going to sleep, so the wakeup cant get lost
+        void notify_sender () {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (this->send_sleeping.load() == true) {
+                // Send thread either checks its wake up condition after this or is already waiting
+                std::lock_guard<std::mutex> lock(this->editing_front_mutex);
+            }
+            this->send_cond_var.notify_one();
+        }
+        // Creates stop event, called before support threads start
+        void open_stop_event () {
+            if ((this->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+                throw std::logic_error("Stop event creation failed");
+        }
+        // Wakes every thread waiting on stop event, it is never read so it stays signaled
+        void signal_stop () {
+            uint64_t value = 1;
+            if (this->stop_fd >= 0 && write(this->stop_fd, &value, sizeof(value)) < 0)
+                OutputClass::out_err_intern("Error while signaling end of session");
+        }
+        // Sleeps send thread on send_cond_var till wake_up holds or deadline (if any) expires, lock has to be held
+        template <typename Predicate>
+        void wait_sender (std::unique_lock<std::mutex>& lock, Predicate wake_up,
+                          std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+            this->send_sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (deadline == std::chrono::steady_clock::time_point::max())
+                this->send_cond_var.wait(lock, wake_up);
+            else
+                this->send_cond_var.wait_until(lock, deadline, wake_up);
+            this->send_sleeping.store(false);
+        }
+        // Handles message received from server, same for both transports and engines. Its state is switched
+        // right here as the next message of the same batch is already judged by it
+        void handle_server_msg (MessageClass& data, int out_id = NO_MSG_ID) {
+            switch (this->cur_state) {
+                case S_START: // Nothing is expected before AUTH was sent
+                    switch_to_error("Unexpected message received");
+                    return;
+                case S_ERROR:
+                case S_END: // Ignore everything
+                    return;
+                default:
+                    break;
+            }
+
+            switch (data.type) {
+                case REPLY:
+                    // Replying to unexpected message id
+                    if (reply_expected(data.ref_msg_id) == false) {
+                        switch_to_error("Reply message has invalid ref_id");
+                        break;
+                    }
+                    TraceClass::record(T_REPLY, data.ref_msg_id, data.type);
+                    // Output server reply
+                    OutputClass::out_reply(data.result, data.message(), out_id);
+                    if (this->cur_state == S_AUTH && data.result == true) // Positive reply - switch to open
+                        this->cur_state = S_OPEN;
+                    // else: Negative reply -> stay in AUTH state and allow user to re-authenticate
+                    // Reset waiting for reply flag
+                    reply_finished();
+                    break;
+                case MSG: // Output message
+                    if (this->cur_state != S_OPEN) {
+                        switch_to_error("Unexpected message received");
+                        break;
+                    }
+                    OutputClass::out_msg(data.display_name(), data.message(), out_id);
+                    break;
+                case ERR: // Output error and send bye
+                    OutputClass::out_err_server(data.display_name(), data.message(), out_id);
+                    send_priority_bye();
+                    break;
+                case BYE: // End connection
+                    if (this->cur_state != S_OPEN) {
+                        switch_to_error("Unexpected message received");
+                        break;
+                    }
+                    OutputClass::out_bye(out_id);
+                    session_end();
+                    break;
+                default: // Transition to error state
+                    switch_to_error("Unexpected message received");
+                    break;
+            }
+        }
+
+        /* Session of event loop engine, runs as coroutines resumed only from send_pending() on its thread */
+        // Coroutine putting message on the wire, it finishes once server surely has it (UDP: CONFIRM, TCP: written)
+        virtual SessionTaskClass deliver (MessageClass* msg)                                                        = 0;
+        // Returns true if message of given type may go on the wire while earlier ones are still being delivered
+        virtual bool window_open (uint8_t msg_type) {
+            (void)msg_type;
+            return true;
+        }
+        // Session ending message took over, drops everything still being sent
+        virtual void abandon_sent ()                                                                                = 0;
+        // Returns true if REPLY with given ref_msg_id answers request sent by the client
+        virtual bool reply_expected (uint16_t ref_msg_id)                                                           = 0;
+        // Request was answered, lets other messages go
+        virtual void reply_finished ()                                                                              = 0;
+        // Reports error to user and server, then ends the session
+        virtual void switch_to_error (std::string err_msg)                                                          = 0;
+        // Time server has to REPLY in once it has the request, zero for no limit
+        virtual std::chrono::milliseconds reply_timeout () {
+            return std::chrono::milliseconds::zero();
+        }
+
+        // Suspends session till run_session() finds queued message it can take, evaluates to that message
+        struct MessageAwaiter {
+            ClientClass* client;
+
+            bool await_ready () noexcept {
+                return this->client->flow_ready(W_MESSAGE);
+            }
+            void await_suspend (std::coroutine_handle<>) noexcept {
+                this->client->suspend_flow(W_MESSAGE);
+            }
+            MessageClass* await_resume () noexcept {
+                return this->client->take_message();
+            }
+        };
+        // Suspends session till REPLY to its request comes, evaluates to false if its deadline expired first
+        struct ReplyAwaiter {
+            ClientClass* client;
+
+            bool await_ready () noexcept {
+                return this->client->flow_ready(W_REPLY);
+            }
+            void await_suspend (std::coroutine_handle<>) noexcept {
+                this->client->suspend_flow(W_REPLY);
+            }
+            bool await_resume () noexcept {
+                this->client->flow_wait = W_NONE;
+                this->client->reply_deadline = std::chrono::steady_clock::time_point::max();
+                return (this->client->wait_for_reply == false);
+            }
+        };
+
+        MessageAwaiter next_message () {
+            return {this};
+        }
+        ReplyAwaiter reply_for (uint16_t sent_id) {
+            // TCP REPLY carries no ref_msg_id, it refers to the last request
+            this->request_id = sent_id;
+            return {this};
+        }
+        // Protocol state is the point this coroutine is suspended at. MSGs are only put on the wire and delivered
+        // alongside it, AUTH/JOIN are delivered and answered before anything else is taken and BYE is the last one
+        SessionTaskClass session_flow () {
+            while (true) {
+                MessageClass* next = co_await next_message();
+                uint8_t type = next->type;
+
+                // AUTH only till session is open, MSG and JOIN only once it is
+                bool allowed = true;
+                if (type == AUTH)
+                    allowed = (this->cur_state == S_START || this->cur_state == S_AUTH);
+                else if (type == MSG || type == JOIN)
+                    allowed = (this->cur_state == S_OPEN);
+                if (allowed == false) {
+                    OutputClass::out_err_intern("Sending this type of message is prohibited for current client state");
+                    this->pool.release(next);
+                    continue;
+                }
+
+                switch (type) {
+                    case MSG:
+                        start(deliver(next));
+                        break;
+                    case AUTH:
+                    case JOIN: {
+                        // Move to auth state for handling reply msgs
+                        if (type == AUTH)
+                            this->cur_state = S_AUTH;
+                        // REPLY may come as soon as request is on the wire, even before its CONFIRM
+                        uint16_t sent_id = next->msg_id;
+                        this->request_start = std::chrono::steady_clock::now();
+                        this->wait_for_reply = true;
+                        co_await deliver(next);
+                        // Server never confirmed it, session already ended
+                        if (this->end_program == true)
+                            co_return;
+                        if (co_await reply_for(sent_id) == false) {
+                            MetricsClass::count(C_REPLY_TIMEOUTS);
+                            OutputClass::out_err_intern("Timeout for server response, ending connection");
+                            send_priority_bye();
+                        }
+                        break;
+                    }
+                    case ERR:
+                        // Switch to error state, BYE follows
+                        this->cur_state = S_ERROR;
+                        co_await deliver(next);
+                        break;
+                    default:
+                        // Switch to end state, confirmed BYE ends the session
+                        this->cur_state = S_END;
+                        co_await deliver(next);
+                        if (this->end_program == false)
+                            session_end();
+                        co_return;
+                }
+            }
+        }
+        // Creates session coroutine, it is first resumed by run_session()
+        void start_session (size_t max_deliveries) {
+            this->deliveries.reserve(max_deliveries);
+            this->ready.reserve(max_deliveries);
+            this->resuming.reserve(max_deliveries);
+            this->session = session_flow();
+            this->flow_wait = W_START;
+        }
+        // Runs session coroutines till each of them waits for something that didnt happen yet
+        void run_session () {
+            // Session ending message takes over wherever the session is suspended, unless it is taking messages
+            if (this->messages_to_send.front() != nullptr && this->messages_to_send.is_priority() == true &&
+                this->priority_taken == false && this->flow_wait != W_MESSAGE) {
+                drop_deliveries();
+                this->session = session_flow();
+                this->flow_wait = W_START;
+            }
+
+            while (this->end_program == false) {
+                if (this->flow_wait != W_NONE && flow_ready(this->flow_wait) == true) {
+                    this->flow_wait = W_NONE;
+                    this->session.resume();
+                    continue;
+                }
+                if (this->ready.empty() == true)
+                    break;
+                // Coroutines woken meanwhile are resumed in next round, dropping deliveries empties both rounds
+                this->resuming.swap(this->ready);
+                for (size_t index = 0; index < this->resuming.size() && this->end_program == false; ++index)
+                    this->resuming[index].resume();
+                this->resuming.clear();
+            }
+            std::erase_if(this->deliveries, [](SessionTaskClass& delivery) {
+                return delivery.done();
+            });
+        }
+        // Schedules suspended coroutine to be resumed by run_session()
+        void wake (std::coroutine_handle<> handle) {
+            this->ready.push_back(handle);
+        }
+        // Starts delivery running alongside the session, it is kept till it finishes
+        void start (SessionTaskClass delivery) {
+            delivery.resume();
+            if (delivery.done() == false)
+                this->deliveries.push_back(std::move(delivery));
+        }
+        // Returns true when what session waits for already happened
+        bool flow_ready (FLOW_WAIT wait) {
+            switch (wait) {
+                case W_MESSAGE: {
+                    MessageClass** next = this->messages_to_send.front();
+                    if (next == nullptr)
+                        return false;
+                    // First session ending message doesnt wait for anything sent before it
+                    return (this->messages_to_send.is_priority() == true && this->priority_taken == false) ||
+                           window_open((*next)->type);
+                }
+                case W_REPLY:
+                    return (this->wait_for_reply == false ||
+                            std::chrono::steady_clock::now() >= this->reply_deadline);
+                case W_START:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+        void suspend_flow (FLOW_WAIT wait) {
+            this->flow_wait = wait;
+            // Everything user gave is taken, allow reading next user input
+            if (wait == W_MESSAGE && this->messages_to_send.front() == nullptr)
+                allow_user_input();
+            // Server has to REPLY in time once it has the request
+            if (wait == W_REPLY && reply_timeout() > std::chrono::milliseconds::zero())
+                this->reply_deadline = std::chrono::steady_clock::now() + reply_timeout();
+        }
+        // Removes message session waited for from the queue
+        MessageClass* take_message () {
+            this->flow_wait = W_NONE;
+            MessageClass* next = *this->messages_to_send.front();
+            MetricsClass::record(H_QUEUE_DEPTH, this->messages_to_send.size());
+            if (this->messages_to_send.is_priority() == true && this->priority_taken == false)
+                drop_deliveries();
+            this->messages_to_send.pop();
+            return next;
+        }
+        // Session is ending, messages being delivered are dropped together with coroutines delivering them
+        void drop_deliveries () {
+            abandon_sent();
+            this->deliveries.clear();
+            this->ready.clear();
+            this->resuming.clear();
+            this->reply_deadline = std::chrono::steady_clock::time_point::max();
+        }
+
+
         // Transport data
         uint16_t port;
         int socket_id;
-        // Mutex avoid race conditions when accessing and working with the queue
+        // Eventfd signaled by session_end, -1 when client is driven by event loop engine
+        int stop_fd;
+        // Slots of all messages of the session, queues and in-flight list hold only pointers to them
+        MessagePoolClass pool;
+        // Mutex avoid race conditions when taking messages from the queue and working with messages being sent
         std::mutex editing_front_mutex;
         // Supporting threads for send and receive
         std::jthread send_thread;
@@ -152,16 +604,49 @@ class ClientClass {
 
         bool stop_send;
         bool stop_recv;
-        bool high_priority;
         bool load_input;
+        // Send thread is (about to be) waiting on send_cond_var
+        std::atomic<bool> send_sleeping;
+
+        // Msgs waiting to be sent
+        SendQueueClass<MessageClass*> messages_to_send;
+        // Session ending message already took over, messages sent before it were abandoned
+        bool priority_taken;
 
         std::atomic<bool> wait_for_reply;
+        // Time AUTH/JOIN now waiting for REPLY was first sent
+        std::chrono::steady_clock::time_point request_start;
+        // Msg_id of AUTH/JOIN now waiting for REPLY
+        uint16_t request_id;
         std::atomic<bool> end_program;
+        // Support threads are not started when client is driven by event loop engine
+        bool use_threads;
+        // Support threads do socket I/O through io_uring, each falls back to plain syscalls if it isnt available
+        bool use_uring;
+        // Rings of receive and send thread, each one is created and used only by its thread
+        UringClass recv_ring;
+        UringClass send_ring;
+        std::vector<UringCompletion> recv_completions;
+        std::vector<UringCompletion> send_completions;
         std::atomic<FSM_STATE> cur_state;
 
+        // Event loop engine session coroutine, what it is suspended for and deadline of REPLY it waits for
+        SessionTaskClass session;
+        FLOW_WAIT flow_wait;
+        std::chrono::steady_clock::time_point reply_deadline;
+        // Deliveries running alongside the session
+        std::vector<SessionTaskClass> deliveries;
+        // Coroutines woken by received messages and expired deadlines, resumed by run_session()
+        std::vector<std::coroutine_handle<>> ready;
+        std::vector<std::coroutine_handle<>> resuming;
+
         std::condition_variable cond_var;
         std::condition_variable send_cond_var;
         std::condition_variable input_cond_var;
+        // Mutex guarding load_input for input conditional variable
+        std::mutex input_mutex;
+        // Mutex for main function conditional variable
+        std::mutex end_mutex;
 };
 
 #endif // CLIENTCLASS_H
\ No newline at end of file
@@ -14,15 +14,19 @@
 #include <netdb.h>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <csignal>
 #include <thread>
-#include <regex>
 #include <mutex>
 #include <queue>
 #include <atomic>
 #include <stdexcept>
 #include <condition_variable>
 #include <poll.h>
+#include <sys/eventfd.h>
+#include <climits>
+#include <chrono>
 
 #include "OutputClass.h"
 
@@ -49,6 +53,14 @@ enum FSM_STATE : uint8_t {
     S_END
 };
 
+// Enum for what session coroutine of event loop engine waits for
+enum FLOW_WAIT : uint8_t {
+    W_NONE = 0, // Nothing - it runs or waits for delivery of its message
+    W_START,    // Its first resume
+    W_MESSAGE,  // Queued message which can go on the wire
+    W_REPLY     // REPLY to its request or REPLY deadline
+};
+
 // Enum for possible thread events
 enum THREAD_EVENT {
     NO_EVENT = 0,
@@ -0,0 +1,59 @@
+#ifndef DUPFILTERCLASS_H
+#define DUPFILTERCLASS_H
+
+#include "ConstsFile.h"
+
+#include <bitset>
+
+// Remembers already received msg_ids in fixed size bitmap covering whole 16-bit msg_id space.
+// Ids up to half of the space behind the newest one are considered already seen when their bit is set,
+// all others are considered newer and move the window forward, forgetting ids from previous wraparound.
+class DupFilterClass {
+    public:
+        DupFilterClass ()
+        : newest (0),
+          empty  (true)
+        {
+        }
+
+        // Returns true if given msg_id was already received, otherwise marks it as received and returns false
+        bool check_and_mark (uint16_t msg_id) {
+            if (this->empty == true) {
+                this->empty  = false;
+                this->newest = msg_id;
+                this->seen.set(msg_id);
+                return false;
+            }
+
+            uint16_t ahead = static_cast<uint16_t>(msg_id - this->newest);
+            if (ahead == 0 || ahead >= HALF_SPACE) // Newest or older one, decide by its bit
+                return test_and_set(msg_id);
+
+            // Newer msg_id, forget bits of ids window moves over as they belong to previous wraparound
+            for (uint16_t pos = this->newest + 1; pos != msg_id; ++pos)
+                this->seen.reset(pos);
+            this->newest = msg_id;
+            this->seen.set(msg_id);
+            return false;
+        }
+        // Forget all received msg_ids
+        void clear () {
+            this->seen.reset();
+            this->empty = true;
+        }
+
+    private:
+        static constexpr uint32_t HALF_SPACE = 0x8000;
+
+        bool test_and_set (uint16_t msg_id) {
+            bool was_seen = this->seen.test(msg_id);
+            this->seen.set(msg_id);
+            return was_seen;
+        }
+
+        std::bitset<0x10000> seen;
+        uint16_t newest;
+        bool empty;
+};
+
+#endif // DUPFILTERCLASS_H
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef FRAMERCLASS_H
+#define FRAMERCLASS_H
+
+#include "ConstsFile.h"
+
+#include <string_view>
+
+// Splits TCP byte stream into "\r\n" terminated frames inside fixed size buffer.
+// Unprocessed data is moved to buffer start only when there is no space left behind it,
+// so each frame stays contiguous and can be returned without copying.
+class FramerClass {
+    public:
+        static constexpr size_t CAPACITY = 8 * MAXLENGTH;
+
+        FramerClass ()
+        : read_pos  (0),
+          scan_pos  (0),
+          write_pos (0)
+        {
+        }
+
+        // Returns pointer to free space for next received data
+        char* write_ptr () {
+            compact();
+            return this->buffer + this->write_pos;
+        }
+        // Returns size of free space for next received data, zero means incomplete frame fills whole buffer
+        size_t write_space () {
+            compact();
+            return CAPACITY - this->write_pos;
+        }
+        // Marks given number of bytes written to write_ptr() as received
+        void commit (size_t size) {
+            this->write_pos += size;
+        }
+        // Stores next complete frame without its "\r\n" into frame, false if there is none yet.
+        // Frame is valid till next call of write_ptr()/write_space()
+        bool next_frame (std::string_view& frame) {
+            while (this->scan_pos < this->write_pos) {
+                // Memchr is vectorized by libc, it is the fastest way to find delimiter
+                const char* found = static_cast<const char*>(
+                    std::memchr(this->buffer + this->scan_pos, '\n', this->write_pos - this->scan_pos));
+                if (found == nullptr) {
+                    // Dont scan already checked data again once rest of frame arrives
+                    this->scan_pos = this->write_pos;
+                    return false;
+                }
+
+                size_t newline_pos = found - this->buffer;
+                this->scan_pos = newline_pos + 1;
+                // Lone '\n' is part of frame content
+                if (newline_pos == this->read_pos || this->buffer[newline_pos - 1] != '\r')
+                    continue;
+
+                frame = std::string_view(this->buffer + this->read_pos, newline_pos - 1 - this->read_pos);
+                this->read_pos = this->scan_pos;
+                return true;
+            }
+            return false;
+        }
+        // Drops all received data
+        void clear () {
+            this->read_pos  = 0;
+            this->scan_pos  = 0;
+            this->write_pos = 0;
+        }
+
+    private:
+        void compact () {
+            // Everything processed, start from beginning
+            if (this->read_pos == this->write_pos) {
+                clear();
+                return;
+            }
+            // Move incomplete frame to buffer start when running out of space behind it
+            if (this->read_pos > 0 && this->write_pos == CAPACITY) {
+                size_t pending = this->write_pos - this->read_pos;
+                std::memmove(this->buffer, this->buffer + this->read_pos, pending);
+                this->scan_pos -= this->read_pos;
+                this->write_pos = pending;
+                this->read_pos  = 0;
+            }
+        }
+
+        char buffer[CAPACITY];
+        size_t read_pos;
+        size_t scan_pos;
+        size_t write_pos;
+};
+
+#endif // FRAMERCLASS_H
\ No newline at end of file
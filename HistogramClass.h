@@ -0,0 +1,127 @@
+#ifndef HISTOGRAMCLASS_H
+#define HISTOGRAMCLASS_H
+
+#include "ConstsFile.h"
+
+#include <array>
+#include <bit>
+#include <cmath>
+
+// Counter written by single thread and read by any. Increment is plain load and store, so it costs
+// the same as non-atomic one, while concurrent reader still sees whole values
+class RelaxedCounter {
+    public:
+        RelaxedCounter (uint64_t value = 0)
+        : value (value)
+        {
+        }
+
+        RelaxedCounter& operator+= (uint64_t added) {
+            this->value.store(this->value.load(std::memory_order_relaxed) + added, std::memory_order_relaxed);
+            return *this;
+        }
+        RelaxedCounter& operator++ () {
+            return *this += 1;
+        }
+        RelaxedCounter& operator= (uint64_t new_value) {
+            this->value.store(new_value, std::memory_order_relaxed);
+            return *this;
+        }
+        operator uint64_t () const {
+            return this->value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<uint64_t> value;
+};
+
+// Histogram of non-negative values (latencies in ns) with fixed memory. Each power of two range is split
+// into SUB_BUCKETS linear buckets, so any percentile is reported with relative error below 1/SUB_BUCKETS.
+// Counter is plain integer for histogram owned by one thread, RelaxedCounter when other threads read it
+template <typename Counter>
+class BasicHistogramClass {
+    template <typename Other>
+    friend class BasicHistogramClass;
+
+    public:
+        BasicHistogramClass ()
+        : buckets (),
+          total   (0),
+          sum     (0),
+          maximum (0)
+        {
+        }
+
+        void record (uint64_t value) {
+            ++this->buckets[index_of(value)];
+            ++this->total;
+            this->sum += value;
+            if (value > this->maximum)
+                this->maximum = value;
+        }
+        // Adds all values recorded by other histogram
+        template <typename Other>
+        void merge (const BasicHistogramClass<Other>& other) {
+            for (size_t index = 0; index < BUCKETS; ++index)
+                this->buckets[index] += other.buckets[index];
+            this->total += other.total;
+            this->sum += other.sum;
+            this->maximum = std::max<uint64_t>(this->maximum, other.maximum);
+        }
+        // Returns value below which lies given percentile [0-100] of recorded values, 0 if there are none
+        uint64_t percentile (double percent) const {
+            if (this->total == 0)
+                return 0;
+            uint64_t rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * this->total));
+            rank = std::clamp<uint64_t>(rank, 1, this->total);
+
+            uint64_t seen = 0;
+            for (size_t index = 0; index < BUCKETS; ++index) {
+                seen += this->buckets[index];
+                if (seen >= rank)
+                    return std::min<uint64_t>(upper_bound(index), this->maximum);
+            }
+            return this->maximum;
+        }
+        uint64_t count () const {
+            return this->total;
+        }
+        uint64_t max () const {
+            return this->maximum;
+        }
+        double mean () const {
+            return (this->total == 0) ? 0.0 : static_cast<double>(this->sum) / this->total;
+        }
+
+    private:
+        static constexpr unsigned SUB_BITS    = 5;
+        static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+        // Values below SUB_BUCKETS have own bucket each, then SUB_BUCKETS buckets for every power of two
+        static constexpr size_t BUCKETS       = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+        static size_t index_of (uint64_t value) {
+            if (value < SUB_BUCKETS)
+                return value;
+            // Keep SUB_BITS bits below the highest set bit
+            unsigned shift = (63 - std::countl_zero(value)) - SUB_BITS;
+            return shift * SUB_BUCKETS + (value >> shift);
+        }
+        static uint64_t upper_bound (size_t index) {
+            if (index < SUB_BUCKETS)
+                return index;
+            unsigned shift = index / SUB_BUCKETS - 1;
+            uint64_t top = index - shift * SUB_BUCKETS;
+            return ((top + 1) << shift) - 1;
+        }
+
+        std::array<Counter, BUCKETS> buckets;
+        Counter total;
+        Counter sum;
+        Counter maximum;
+};
+
+typedef BasicHistogramClass<uint64_t> HistogramClass;
+// Recorded by one thread, read by others
+typedef BasicHistogramClass<RelaxedCounter> SharedHistogramClass;
+
+#endif // HISTOGRAMCLASS_H
\ No newline at end of file
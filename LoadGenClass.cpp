@@ -0,0 +1,429 @@
+#include "LoadGenClass.h"
+
+// Max number of lines single session passes to its client at once, so it cant starve other sessions of its worker
+#define MAX_LINES_PER_DRIVE 32
+
+LoadSessionClass::LoadSessionClass (std::unique_ptr<ClientClass> client, size_t session_id, size_t msgs_count,
+                                    clock::duration send_interval, size_t payload_size, LoadStats* stats)
+    : scheduled      (clock::time_point::max()),
+      finished       (false),
+      client         (std::move(client)),
+      session_id     (session_id),
+      msgs_count     (msgs_count),
+      msgs_sent      (0),
+      send_interval  (send_interval),
+      payload_size   (payload_size),
+      stats          (stats),
+      waiting        (L_INPUT),
+      wait_for_input (false),
+      replied        (false),
+      reply_result   (false),
+      yielded        (false),
+      script         (run_script())
+{
+}
+/***********************************************************************************/
+SessionTaskClass LoadSessionClass::run_script () {
+    std::string name = "lg" + std::to_string(this->session_id);
+    // /auth {Username} {Secret} {DisplayName}, server refusing it ends the session
+    if (co_await request("/auth " + name + " secret " + name) == true) {
+        co_await request("/join loadgen");
+        // Sending starts once JOIN is answered
+        clock::time_point next_send = this->now;
+        for (size_t sent = 0; sent < this->msgs_count; ++sent) {
+            co_await sleep_until(next_send);
+            next_send += this->send_interval;
+            compose_msg();
+            ++this->stats->msgs_sent;
+            co_await send(this->line);
+        }
+    }
+    this->client->send_bye();
+}
+/***********************************************************************************/
+LoadSessionClass::SessionAwaiter LoadSessionClass::send (const std::string& line) {
+    this->waiting = L_INPUT;
+    this->wait_for_input = this->client->run_user_command(ClientClass::parse_user_line(line), false);
+    // Line is sent by drive() first
+    return {this, false};
+}
+/***********************************************************************************/
+LoadSessionClass::SessionAwaiter LoadSessionClass::request (const std::string& line) {
+    this->request_start = clock::now();
+    this->replied = false;
+    SessionAwaiter awaiter = send(line);
+    // Client may take next line before REPLY arrives (UDP window), but script depends on it
+    this->waiting = L_REPLY;
+    return awaiter;
+}
+/***********************************************************************************/
+LoadSessionClass::SessionAwaiter LoadSessionClass::sleep_until (clock::time_point time) {
+    this->waiting = L_TIME;
+    this->wake = time;
+    return {this, resumable()};
+}
+/***********************************************************************************/
+bool LoadSessionClass::resumable () {
+    // Previous line is still being processed by client
+    if (this->wait_for_input == true) {
+        if (this->client->load_user_input() == false)
+            return false;
+        this->client->set_load_user_input(false);
+        this->wait_for_input = false;
+    }
+    switch (this->waiting) {
+        case L_REPLY:
+            return this->replied;
+        case L_TIME:
+            return this->now >= this->wake;
+        default:
+            return true;
+    }
+}
+/***********************************************************************************/
+bool LoadSessionClass::drive (clock::time_point now) {
+    // Events of the client belong to this session
+    OutputClass::set_thread_sink(this);
+    this->now = now;
+    this->yielded = false;
+    for (size_t lines = 0; this->client->stop_program() == false; ++lines) {
+        if (lines == MAX_LINES_PER_DRIVE) {
+            this->yielded = true;
+            break;
+        }
+        // Script passes at most one line before it suspends again
+        bool resumed = (this->script.done() == false && resumable() == true);
+        if (resumed == true)
+            this->script.resume();
+        this->client->send_pending();
+        // Client session takes queued lines only when driven, the script may go on right after that
+        if (resumed == false && (this->script.done() == true || resumable() == false))
+            break;
+    }
+    OutputClass::set_thread_sink(nullptr);
+
+    if (this->client->stop_program() == true) {
+        if (this->finished == false)
+            ++this->stats->sessions_ended;
+        this->finished = true;
+        return false;
+    }
+    return true;
+}
+/***********************************************************************************/
+void LoadSessionClass::receive () {
+    OutputClass::set_thread_sink(this);
+    this->client->receive_pending();
+    OutputClass::set_thread_sink(nullptr);
+}
+/***********************************************************************************/
+LoadSessionClass::clock::time_point LoadSessionClass::wake_time () {
+    clock::time_point wake = clock::time_point::max();
+    // Gave up its turn with more lines to pass
+    if (this->yielded == true)
+        wake = clock::now();
+    // Script sleeps till next MSG is due
+    else if (this->waiting == L_TIME && this->wait_for_input == false)
+        wake = this->wake;
+
+    // Client itself waits for retransmission or REPLY deadline
+    clock::time_point deadline;
+    if (this->client->next_deadline(deadline) == true)
+        wake = std::min(wake, deadline);
+    return wake;
+}
+/***********************************************************************************/
+void LoadSessionClass::compose_msg () {
+    // Send time travels inside the message, so any session receiving it back can measure latency
+    uint64_t sent_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+    char digits[20];
+    char* digits_end = std::to_chars(digits, digits + sizeof(digits), sent_ns).ptr;
+
+    this->line.assign("lg ");
+    this->line.append(digits, digits_end - digits);
+    this->line.push_back(' ');
+    if (this->line.size() < this->payload_size)
+        this->line.append(this->payload_size - this->line.size(), 'x');
+}
+/***********************************************************************************/
+void LoadSessionClass::on_event (OUTPUT_EVENT type, std::string_view display_name, std::string_view msg, bool result) {
+    (void)display_name;
+    clock::time_point now = clock::now();
+    switch (type) {
+        case E_MSG: {
+            ++this->stats->msgs_received;
+            // Only messages sent by load generator carry their send time
+            size_t tag = msg.find("lg ");
+            if (tag == std::string_view::npos)
+                break;
+            uint64_t sent_ns;
+            const char* digits = msg.data() + tag + 3;
+            auto [digits_end, error] = std::from_chars(digits, msg.data() + msg.size(), sent_ns);
+            if (error != std::errc() || digits_end == msg.data() + msg.size() || *digits_end != ' ')
+                break;
+            uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+            if (now_ns >= sent_ns)
+                this->stats->msg_latency.record(now_ns - sent_ns);
+            break;
+        }
+        case E_REPLY:
+            if (result == true)
+                ++this->stats->replies_ok;
+            else
+                ++this->stats->replies_failed;
+            this->stats->reply_latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->request_start).count());
+            this->replied = true;
+            this->reply_result = result;
+            break;
+        case E_ERR:
+            ++this->stats->server_errors;
+            break;
+        case E_INTERNAL_ERR:
+            ++this->stats->internal_errors;
+            if (this->stats->first_error.empty() == true)
+                this->stats->first_error = msg;
+            break;
+        default:
+            break;
+    }
+}
+/***********************************************************************************/
+LoadGenClass::LoadGenClass (std::map<std::string, std::string> data_map)
+    : protocol       ("udp"),
+      sessions_count (1),
+      threads_count  (1),
+      msgs_count     (10),
+      rate           (1.0),
+      payload_size   (64),
+      time_limit     (60)
+{
+    std::map<std::string, std::string>::iterator iter;
+    // Look for init values in map to override init values
+    if ((iter = data_map.find("type")) != data_map.end())
+        this->protocol = iter->second;
+
+    if ((iter = data_map.find("sessions")) != data_map.end())
+        this->sessions_count = std::stoul(iter->second);
+
+    if ((iter = data_map.find("threads")) != data_map.end())
+        this->threads_count = std::max<size_t>(1, std::stoul(iter->second));
+
+    if ((iter = data_map.find("count")) != data_map.end())
+        this->msgs_count = std::stoul(iter->second);
+
+    if ((iter = data_map.find("rate")) != data_map.end())
+        this->rate = std::max(0.0, std::stod(iter->second));
+
+    if ((iter = data_map.find("size")) != data_map.end())
+        this->payload_size = std::min<size_t>(std::stoul(iter->second), 1400);
+
+    if ((iter = data_map.find("limit")) != data_map.end())
+        this->time_limit = std::chrono::seconds(std::stoul(iter->second));
+
+    if (this->protocol != "udp" && this->protocol != "tcp")
+        throw std::logic_error("Unknown client type provided");
+
+    // Window is kept in 16 bits by UDPClass, bigger value would silently wrap around
+    if ((iter = data_map.find("window")) != data_map.end()) {
+        long window_size = std::strtol(iter->second.c_str(), nullptr, 10);
+        if (window_size < 1 || window_size > UINT16_MAX)
+            throw std::logic_error("Invalid send window size");
+    }
+
+    // Rest of the values is passed to clients, which are always driven by event loop
+    this->client_args = data_map;
+    this->client_args["engine"] = "epoll";
+}
+/***********************************************************************************/
+void LoadGenClass::run () {
+    // Zero rate means sending as fast as client allows
+    clock::duration send_interval = clock::duration::zero();
+    if (this->rate > 0)
+        send_interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / this->rate));
+
+    // Open all sessions first, workers take every threads_count-th of them
+    std::vector<std::vector<std::unique_ptr<LoadSessionClass>>> worker_sessions(this->threads_count);
+    std::vector<LoadStats> worker_stats(this->threads_count);
+    size_t opened = 0;
+    for (size_t index = 0; index < this->sessions_count; ++index) {
+        std::unique_ptr<ClientClass> client;
+        if (this->protocol == "tcp")
+            client = std::make_unique<TCPClass>(this->client_args);
+        else
+            client = std::make_unique<UDPClass>(this->client_args);
+
+        try {
+            client->open_connection();
+        } catch (const std::logic_error& e) {
+            OutputClass::out_err_intern(e.what());
+            continue;
+        }
+        size_t worker = opened % this->threads_count;
+        worker_sessions[worker].push_back(std::make_unique<LoadSessionClass>(
+            std::move(client), index, this->msgs_count, send_interval, this->payload_size, &worker_stats[worker]));
+        ++opened;
+    }
+
+    clock::time_point start = clock::now();
+    {
+        std::vector<std::jthread> workers;
+        for (size_t worker = 0; worker < this->threads_count; ++worker)
+            workers.emplace_back(&LoadGenClass::run_worker, this, std::ref(worker_sessions[worker]), start + this->time_limit);
+    } // Workers are joined when getting out of scope
+    double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+    LoadStats total;
+    for (LoadStats& stats : worker_stats) {
+        total.msgs_sent       += stats.msgs_sent;
+        total.msgs_received   += stats.msgs_received;
+        total.replies_ok      += stats.replies_ok;
+        total.replies_failed  += stats.replies_failed;
+        total.server_errors   += stats.server_errors;
+        total.internal_errors += stats.internal_errors;
+        total.sessions_ended  += stats.sessions_ended;
+        total.reply_latency.merge(stats.reply_latency);
+        total.msg_latency.merge(stats.msg_latency);
+        if (total.first_error.empty() == true)
+            total.first_error = stats.first_error;
+    }
+    report(total, opened, elapsed);
+}
+/***********************************************************************************/
+void LoadGenClass::run_worker (std::vector<std::unique_ptr<LoadSessionClass>>& sessions, clock::time_point end_time) {
+    int epoll_fd = epoll_create1(0);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (epoll_fd < 0 || timer_fd < 0) {
+        OutputClass::out_err_intern("Epoll instance or timer creation failed");
+        return;
+    }
+
+    // Timer is recognized by missing session
+    struct epoll_event timer_event = {
+        .events = EPOLLIN,
+        .data = {.ptr = nullptr}
+    };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &timer_event);
+    for (auto& session : sessions) {
+        struct epoll_event event = {
+            .events = EPOLLIN,
+            .data = {.ptr = session.get()}
+        };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, session->get_socket(), &event) < 0)
+            OutputClass::out_err_intern("Adding descriptor to epoll instance failed");
+    }
+
+    // Wake up times of sessions, earliest on top. Entry is valid only if session is still scheduled at its time
+    using entry = std::pair<clock::time_point, LoadSessionClass*>;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> schedule;
+    size_t active = sessions.size();
+    auto drive = [&](LoadSessionClass* session, clock::time_point now) {
+        if (session->finished == true)
+            return;
+        if (session->drive(now) == false) {
+            --active;
+            return;
+        }
+        clock::time_point wake = session->wake_time();
+        if (wake != session->scheduled) {
+            session->scheduled = wake;
+            if (wake != clock::time_point::max())
+                schedule.push({wake, session});
+        }
+    };
+
+    for (auto& session : sessions)
+        drive(session.get(), clock::now());
+
+    struct epoll_event events[64];
+    std::vector<LoadSessionClass*> due;
+    while (active > 0) {
+        clock::time_point now = clock::now();
+        if (now >= end_time)
+            break;
+
+        // Take all sessions whose time came first, driving them may schedule them again
+        due.clear();
+        while (schedule.empty() == false && schedule.top().first <= now) {
+            auto [wake, session] = schedule.top();
+            schedule.pop();
+            if (wake != session->scheduled)
+                continue;
+            session->scheduled = clock::time_point::max();
+            due.push_back(session);
+        }
+        for (LoadSessionClass* session : due)
+            drive(session, now);
+        if (active == 0)
+            break;
+
+        // Sleep till earliest scheduled session or till socket event
+        clock::time_point wake = end_time;
+        if (schedule.empty() == false)
+            wake = std::min(wake, schedule.top().first);
+        int64_t wake_ns = std::max<int64_t>(1,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count());
+        struct itimerspec timer_spec = {};
+        timer_spec.it_value.tv_sec  = wake_ns / 1000000000;
+        timer_spec.it_value.tv_nsec = wake_ns % 1000000000;
+        timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer_spec, nullptr);
+
+        int events_count = epoll_wait(epoll_fd, events, 64, -1);
+        if (events_count < 0) {
+            if (errno == EINTR)
+                continue;
+            OutputClass::out_err_intern("Waiting for events failed");
+            break;
+        }
+        for (int index = 0; index < events_count; ++index) {
+            LoadSessionClass* session = static_cast<LoadSessionClass*>(events[index].data.ptr);
+            if (session == nullptr) {
+                // Clear timer expiration, due sessions are driven in next iteration
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+                    OutputClass::out_err_intern("Error while reading timer");
+            }
+            else if (session->finished == false) {
+                session->receive();
+                drive(session, clock::now());
+            }
+        }
+    }
+    close(timer_fd);
+    close(epoll_fd);
+}
+/***********************************************************************************/
+void LoadGenClass::report (LoadStats& total, size_t opened, double elapsed) {
+    char line[512];
+    snprintf(line, sizeof(line), "%s sessions: %zu opened of %zu, %lu ended, %zu threads, %.3f s",
+             this->protocol.c_str(), opened, this->sessions_count, total.sessions_ended, this->threads_count, elapsed);
+    OutputClass::out_line(line);
+    snprintf(line, sizeof(line), "MSG sent: %lu (%.1f msgs/s), received: %lu (%.1f msgs/s)",
+             total.msgs_sent, total.msgs_sent / elapsed, total.msgs_received, total.msgs_received / elapsed);
+    OutputClass::out_line(line);
+    snprintf(line, sizeof(line), "REPLY ok: %lu, failed: %lu, server ERR: %lu, internal errors: %lu",
+             total.replies_ok, total.replies_failed, total.server_errors, total.internal_errors);
+    OutputClass::out_line(line);
+
+    // Datagrams include CONFIRMs, syscalls are counted by UDPClass (nothing when built with METRICS=0)
+    uint64_t datagrams = MetricsClass::total(C_MSGS_SENT) + MetricsClass::total(C_MSGS_RECEIVED);
+    uint64_t syscalls = MetricsClass::total(C_SEND_SYSCALLS) + MetricsClass::total(C_RECV_SYSCALLS);
+    if (this->protocol == "udp" && datagrams > 0) {
+        snprintf(line, sizeof(line), "UDP datagrams: %lu (%.1f datagrams/s), syscalls: %lu send + %lu receive (%.3f per datagram)",
+                 datagrams, datagrams / elapsed, MetricsClass::total(C_SEND_SYSCALLS), MetricsClass::total(C_RECV_SYSCALLS),
+                 static_cast<double>(syscalls) / datagrams);
+        OutputClass::out_line(line);
+    }
+
+    auto out_latency = [&](const char* name, HistogramClass& histogram) {
+        snprintf(line, sizeof(line), "%s latency [us]: n=%lu mean=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f",
+                 name, histogram.count(), histogram.mean() / 1000,
+                 histogram.percentile(50) / 1000.0, histogram.percentile(90) / 1000.0, histogram.percentile(99) / 1000.0,
+                 histogram.percentile(99.9) / 1000.0, histogram.max() / 1000.0);
+        OutputClass::out_line(line);
+    };
+    out_latency("REPLY", total.reply_latency);
+    out_latency("MSG", total.msg_latency);
+
+    if (total.first_error.empty() == false)
+        OutputClass::out_line("First internal error: " + total.first_error);
+}
\ No newline at end of file
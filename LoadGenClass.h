@@ -0,0 +1,136 @@
+#ifndef LOADGENCLASS_H
+#define LOADGENCLASS_H
+
+#include "UDPClass.h"
+#include "TCPClass.h"
+#include "HistogramClass.h"
+#include "SessionTaskClass.h"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <memory>
+
+// What suspended script of load session waits for, besides client taking the last passed line
+enum SESSION_WAIT : uint8_t {
+    L_INPUT = 0, // Nothing else
+    L_REPLY,     // REPLY to passed AUTH/JOIN
+    L_TIME       // Time of next MSG
+};
+
+// Results collected by sessions of single worker thread, merged once workers finish
+typedef struct {
+    uint64_t msgs_sent       = 0;
+    uint64_t msgs_received   = 0;
+    uint64_t replies_ok      = 0;
+    uint64_t replies_failed  = 0;
+    uint64_t server_errors   = 0;
+    uint64_t internal_errors = 0;
+    uint64_t sessions_ended  = 0;
+    // AUTH/JOIN sent -> REPLY received
+    HistogramClass reply_latency;
+    // MSG sent -> same MSG received back (echo or broadcast from server)
+    HistogramClass msg_latency;
+    std::string first_error;
+} LoadStats;
+
+// Single session driven by load generator worker - authenticates, joins channel,
+// sends given number of MSGs at given rate and says BYE. Protocol itself is handled by UDPClass/TCPClass,
+// the script is coroutine resumed by worker thread whenever what it waits for holds
+class LoadSessionClass : public EventSinkClass {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        // Suspends script unless it can go on right away, result is that of awaited REPLY
+        struct SessionAwaiter {
+            LoadSessionClass* session;
+            bool ready;
+
+            bool await_ready () noexcept {
+                return this->ready;
+            }
+            void await_suspend (std::coroutine_handle<>) noexcept {
+            }
+            bool await_resume () noexcept {
+                return this->session->reply_result;
+            }
+        };
+
+        LoadSessionClass (std::unique_ptr<ClientClass> client, size_t session_id, size_t msgs_count,
+                          clock::duration send_interval, size_t payload_size, LoadStats* stats);
+        // Feeds client with next steps of the script as far as client and send rate allow, false once session ended
+        bool drive (clock::time_point now);
+        // Processes everything waiting on session socket
+        void receive ();
+        // Returns time session has to be driven at even without socket event, max() if there is none
+        clock::time_point wake_time ();
+        // Counts received events, MSG carries time it was sent at
+        void on_event (OUTPUT_EVENT type, std::string_view display_name, std::string_view msg, bool result) override;
+
+        int get_socket () {
+            return this->client->get_socket();
+        }
+        // Time session is currently scheduled at by worker, older schedule entries are ignored
+        clock::time_point scheduled;
+        // Session ended and was already counted by worker
+        bool finished;
+
+    private:
+        SessionTaskClass run_script ();
+        // Passes line to client, script goes on once client takes next one
+        SessionAwaiter send (const std::string& line);
+        // Passes AUTH/JOIN line to client, script goes on once its REPLY arrives
+        SessionAwaiter request (const std::string& line);
+        SessionAwaiter sleep_until (clock::time_point time);
+        // Returns true when script can go on
+        bool resumable ();
+        void compose_msg ();
+
+        std::unique_ptr<ClientClass> client;
+        size_t session_id;
+        size_t msgs_count;
+        size_t msgs_sent;
+        clock::duration send_interval;
+        size_t payload_size;
+        LoadStats* stats;
+
+        SESSION_WAIT waiting;
+        // Last passed line is still being processed by client
+        bool wait_for_input;
+        // REPLY to last AUTH/JOIN arrived, and its result
+        bool replied;
+        bool reply_result;
+        // Session stopped passing lines to let other sessions run
+        bool yielded;
+        // Time of current drive and time script sleeps till
+        clock::time_point now;
+        clock::time_point wake;
+        clock::time_point request_start;
+        std::string line;
+        SessionTaskClass script;
+};
+
+// Runs many independent sessions inside one process, sessions are split among few event loop threads
+class LoadGenClass {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        std::map<std::string, std::string> client_args;
+        std::string protocol;
+        size_t sessions_count;
+        size_t threads_count;
+        size_t msgs_count;
+        double rate;
+        size_t payload_size;
+        // Sessions not finished till then are abandoned
+        std::chrono::seconds time_limit;
+
+        void run_worker (std::vector<std::unique_ptr<LoadSessionClass>>& sessions, clock::time_point end_time);
+        void report (LoadStats& total, size_t opened, double elapsed);
+
+    public:
+        LoadGenClass (std::map<std::string, std::string> data_map);
+        // Opens all sessions, runs them till they finish and outputs aggregated results
+        void run ();
+};
+
+#endif // LOADGENCLASS_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef MPSCQUEUECLASS_H
+#define MPSCQUEUECLASS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free queue for multiple producer threads and single consumer (Vyukov's ring).
+// Each slot carries sequence number telling whether it is free for producer of given round
+// or filled for consumer, so producers only race for enqueue position by single CAS
+template <typename T, size_t SLOTS>
+class MPSCQueueClass {
+    static_assert((SLOTS & (SLOTS - 1)) == 0 && SLOTS >= 2, "Number of slots has to be power of two");
+
+    public:
+        MPSCQueueClass ()
+        : enqueue_pos (0),
+          dequeue_pos (0),
+          released    (0)
+        {
+            for (uint32_t index = 0; index < SLOTS; ++index)
+                this->slots[index].sequence.store(index, std::memory_order_relaxed);
+        }
+
+        // Appends item, sleeps while queue is full till consumer frees half of it
+        void push (T&& item) {
+            uint32_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+            Slot* slot;
+            while (true) {
+                slot = &this->slots[pos & (SLOTS - 1)];
+                uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+                int32_t diff = static_cast<int32_t>(sequence - pos);
+                if (diff == 0) { // Free slot, try to claim it
+                    if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0) { // Queue is full
+                    // Waking up for each freed slot would switch between producer and consumer for every item,
+                    // so wait till consumer releases next half of the ring
+                    uint32_t released = this->released.load(std::memory_order_acquire);
+                    if (static_cast<int32_t>(slot->sequence.load(std::memory_order_acquire) - pos) < 0)
+                        this->released.wait(released, std::memory_order_acquire);
+                    pos = this->enqueue_pos.load(std::memory_order_relaxed);
+                }
+                else // Claimed by other producer meanwhile
+                    pos = this->enqueue_pos.load(std::memory_order_relaxed);
+            }
+            slot->item = std::move(item);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+        }
+        // Returns oldest item without removing it, nullptr if queue is empty. Consumer only
+        T* front () {
+            Slot& slot = this->slots[this->dequeue_pos & (SLOTS - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != static_cast<uint32_t>(this->dequeue_pos + 1))
+                return nullptr;
+            return &slot.item;
+        }
+        // Removes oldest item returned by front(). Consumer only
+        void pop () {
+            Slot& slot = this->slots[this->dequeue_pos & (SLOTS - 1)];
+            slot.item = T();
+            // Release slot for producers of next round of the ring
+            slot.sequence.store(this->dequeue_pos + SLOTS, std::memory_order_release);
+            ++this->dequeue_pos;
+            // Producers sleeping on full queue are woken once per half of the ring, notifying them of every
+            // slot would cost futex syscall per item while any of them waits
+            if ((this->dequeue_pos & (SLOTS / 2 - 1)) == 0) {
+                this->released.store(this->dequeue_pos, std::memory_order_release);
+                this->released.notify_all();
+            }
+        }
+        // Consumer only
+        bool empty () {
+            return front() == nullptr;
+        }
+        // Number of claimed slots, including ones producers are still filling. Consumer only
+        uint32_t size () {
+            return this->enqueue_pos.load(std::memory_order_relaxed) - this->dequeue_pos;
+        }
+
+    private:
+        typedef struct {
+            // 32-bit so waiting on it maps directly to futex
+            std::atomic<uint32_t> sequence;
+            T item;
+        } Slot;
+
+        Slot slots[SLOTS];
+        std::atomic<uint32_t> enqueue_pos;
+        uint32_t dequeue_pos;
+        // Position consumer reached at last half of the ring boundary, full queue producers sleep on it
+        std::atomic<uint32_t> released;
+};
+
+#endif // MPSCQUEUECLASS_H
\ No newline at end of file
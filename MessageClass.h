@@ -0,0 +1,97 @@
+#ifndef MESSAGECLASS_H
+#define MESSAGECLASS_H
+
+#include "ConstsFile.h"
+
+#include <string_view>
+
+// Content fields of protocol messages, each message type uses at most three of them
+enum MSG_PART : uint8_t {
+    P_USER_NAME = 0,
+    P_DISPLAY_NAME,
+    P_SECRET,
+    P_CHANNEL_ID,
+    P_MESSAGE,
+    P_COUNT
+};
+
+// Longest valid content of any message - MSG/ERR with 20 chars of display name and 1400 chars of message
+#define MSG_PAYLOAD_SIZE (20 + 1400)
+
+// Message of both UDP and TCP client. Fields are stored one after another in single inline buffer
+// and described by offset and length, so message never allocates and is passed around by pointer.
+// Constructor doesnt touch the buffer, so unused tail of it costs nothing
+class MessageClass {
+    public:
+        MessageClass (uint8_t type = NO_TYPE)
+        : type       (type),
+          result     (false),
+          sent       (false),
+          msg_id     (0),
+          ref_msg_id (0),
+          sends_left (0),
+          sent_at    (),
+          overflow   (false),
+          used       (0),
+          offsets    {},
+          lengths    {}
+        {
+        }
+
+        // Returns value of given field, empty if it was not set
+        std::string_view get (MSG_PART part) const {
+            return std::string_view(this->payload + this->offsets[part], this->lengths[part]);
+        }
+        // Copies value of given field behind already stored ones, false (and message marked invalid) if it doesnt fit
+        bool set (MSG_PART part, std::string_view value) {
+            if (value.size() > static_cast<size_t>(MSG_PAYLOAD_SIZE - this->used)) {
+                this->overflow = true;
+                return false;
+            }
+            std::memcpy(this->payload + this->used, value.data(), value.size());
+            this->offsets[part] = this->used;
+            this->lengths[part] = static_cast<uint16_t>(value.size());
+            this->used += static_cast<uint16_t>(value.size());
+            return true;
+        }
+        // Returns true if some field value didnt fit, such message is never valid
+        bool overflowed () const {
+            return this->overflow;
+        }
+
+        std::string_view user_name () const {
+            return get(P_USER_NAME);
+        }
+        std::string_view display_name () const {
+            return get(P_DISPLAY_NAME);
+        }
+        std::string_view secret () const {
+            return get(P_SECRET);
+        }
+        std::string_view channel_id () const {
+            return get(P_CHANNEL_ID);
+        }
+        std::string_view message () const {
+            return get(P_MESSAGE);
+        }
+
+        uint8_t type;
+        bool result;
+        // Message was put on the wire
+        bool sent;
+        uint16_t msg_id;
+        uint16_t ref_msg_id;
+        // Number of (re)transmissions left (UDP only)
+        uint16_t sends_left;
+        // Time of first transmission, reset once retransmitted so its confirmation isnt sampled (UDP only)
+        std::chrono::steady_clock::time_point sent_at;
+
+    private:
+        bool overflow;
+        uint16_t used;
+        uint16_t offsets[P_COUNT];
+        uint16_t lengths[P_COUNT];
+        char payload[MSG_PAYLOAD_SIZE];
+};
+
+#endif // MESSAGECLASS_H
\ No newline at end of file
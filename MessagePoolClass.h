@@ -0,0 +1,94 @@
+#ifndef MESSAGEPOOLCLASS_H
+#define MESSAGEPOOLCLASS_H
+
+#include "MessageClass.h"
+
+#include <memory>
+#include <new>
+
+// Fixed number of message slots owned by single session. Slots are handed out and returned by any thread
+// without locking - free slots form a stack linked by slot indexes, its top is tagged by change counter
+// so slot taken and returned meanwhile by other threads cant be mistaken for unchanged top.
+// Storage is not initialized in advance, slots never used are never touched
+class MessagePoolClass {
+    public:
+        MessagePoolClass ()
+        : capacity (0),
+          fresh    (0),
+          top      (0),
+          taken    (0)
+        {
+        }
+
+        // Allocates storage for given number of messages, has to be called before first acquire
+        void init (uint32_t capacity) {
+            this->storage.reset(new std::byte[capacity * sizeof(MessageClass)]);
+            this->next.reset(new std::atomic<uint32_t>[capacity]);
+            this->capacity = capacity;
+            this->fresh.store(0);
+            this->top.store(0);
+        }
+        // Returns new message of given type, yields while all slots are taken
+        MessageClass* acquire (uint8_t type) {
+            while (true) {
+                // Reuse returned slot first
+                uint64_t cur_top = this->top.load(std::memory_order_acquire);
+                while (slot_of(cur_top) != EMPTY) {
+                    uint32_t index = slot_of(cur_top);
+                    uint64_t new_top = tagged(cur_top, this->next[index].load(std::memory_order_relaxed));
+                    if (this->top.compare_exchange_weak(cur_top, new_top, std::memory_order_acquire, std::memory_order_acquire)) {
+                        this->taken.fetch_add(1, std::memory_order_relaxed);
+                        return new (slot(index)) MessageClass(type);
+                    }
+                }
+                // Then take slot never used before
+                uint32_t index = this->fresh.load(std::memory_order_relaxed);
+                while (index < this->capacity) {
+                    if (this->fresh.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                        this->taken.fetch_add(1, std::memory_order_relaxed);
+                        return new (slot(index)) MessageClass(type);
+                    }
+                }
+                // Pool is sized for all queues being full, so this is only short wait for consumer
+                std::this_thread::yield();
+            }
+        }
+        // Returns message slot back to the pool
+        void release (MessageClass* msg) {
+            uint32_t index = static_cast<uint32_t>((reinterpret_cast<std::byte*>(msg) - this->storage.get()) / sizeof(MessageClass));
+            uint64_t cur_top = this->top.load(std::memory_order_relaxed);
+            do {
+                this->next[index].store(slot_of(cur_top), std::memory_order_relaxed);
+            } while (this->top.compare_exchange_weak(cur_top, tagged(cur_top, index), std::memory_order_release, std::memory_order_relaxed) == false);
+            this->taken.fetch_sub(1, std::memory_order_relaxed);
+        }
+        // Number of messages taken and not returned yet - queued or waiting for CONFIRM
+        uint32_t in_use () {
+            return this->taken.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Lower half of the top is index of the slot, upper half counts changes
+        static constexpr uint32_t EMPTY = UINT32_MAX;
+
+        static uint32_t slot_of (uint64_t tagged_top) {
+            return static_cast<uint32_t>(tagged_top) - 1;
+        }
+        static uint64_t tagged (uint64_t old_top, uint32_t index) {
+            return ((old_top >> 32) + 1) << 32 | static_cast<uint32_t>(index + 1);
+        }
+        void* slot (uint32_t index) {
+            return this->storage.get() + index * sizeof(MessageClass);
+        }
+
+        std::unique_ptr<std::byte[]> storage;
+        // Index of the slot below each free one, EMPTY for the last one
+        std::unique_ptr<std::atomic<uint32_t>[]> next;
+        uint32_t capacity;
+        // Slots from this index on were never used
+        std::atomic<uint32_t> fresh;
+        std::atomic<uint64_t> top;
+        std::atomic<uint32_t> taken;
+};
+
+#endif // MESSAGEPOOLCLASS_H
\ No newline at end of file
@@ -0,0 +1,240 @@
+#ifndef METRICSCLASS_H
+#define METRICSCLASS_H
+
+#include "HistogramClass.h"
+#include "WriterClass.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <fcntl.h>
+#include <signal.h>
+
+// Counted events
+enum METRIC_COUNTER : uint8_t {
+    C_MSGS_SENT = 0,     // Messages put on the wire, retransmissions included
+    C_MSGS_RECEIVED,     // Messages received from server, duplicates included
+    C_RETRANSMITS,       // UDP messages resent after CONFIRM timeout
+    C_SEND_TIMEOUTS,     // UDP messages not confirmed even after all retransmissions
+    C_REPLY_TIMEOUTS,    // UDP AUTH/JOIN not replied to in time
+    C_DUPLICATES,        // UDP messages dropped by filter of already processed msg_ids
+    C_CONFIRMS_RECEIVED, // UDP CONFIRM messages
+    C_SEND_SYSCALLS,     // Socket sendto/sendmmsg/send calls and io_uring submits of sends
+    C_RECV_SYSCALLS,     // Socket recvmmsg/recv calls and io_uring submits waiting for received data
+    C_COUNT
+};
+
+// Distributions of measured values
+enum METRIC_HISTOGRAM : uint8_t {
+    H_REPLY_WAIT = 0, // AUTH/JOIN first sent -> its REPLY received [ns]
+    H_CONFIRM_RTT,    // UDP message sent -> its CONFIRM received, retransmitted ones excluded [ns]
+    H_QUEUE_DEPTH,    // Messages in messages_to_send when sender takes one
+    H_COUNT
+};
+
+// Current values, last one set wins
+enum METRIC_GAUGE : uint8_t {
+    G_RTO_US = 0, // UDP retransmission timeout [us]
+    G_SRTT_US,    // UDP smoothed CONFIRM round trip time [us]
+    G_RTTVAR_US,  // UDP CONFIRM round trip time variation [us]
+    G_COUNT
+};
+
+// Runtime metrics of the client. Every thread records into its own shard with plain loads and stores,
+// so recording takes no lock and shares no cache line. Dump sums all shards, it is written on SIGUSR1
+// and at exit. Build with -DNO_METRICS (make METRICS=0) compiles recording out
+class MetricsClass {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        static void count (METRIC_COUNTER counter, uint64_t value = 1) {
+#ifndef NO_METRICS
+            shard().counters[counter] += value;
+#else
+            (void)counter;
+            (void)value;
+#endif
+        }
+        static void record (METRIC_HISTOGRAM histogram, uint64_t value) {
+#ifndef NO_METRICS
+            shard().histograms[histogram].record(value);
+#else
+            (void)histogram;
+            (void)value;
+#endif
+        }
+        static void set (METRIC_GAUGE gauge, int64_t value) {
+#ifndef NO_METRICS
+            gauges[gauge].store(value, std::memory_order_relaxed);
+#else
+            (void)gauge;
+            (void)value;
+#endif
+        }
+        // Records nanoseconds elapsed since given time
+        static void record_since (METRIC_HISTOGRAM histogram, clock::time_point start) {
+#ifndef NO_METRICS
+            record(histogram, std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+#else
+            (void)histogram;
+            (void)start;
+#endif
+        }
+        // Sum of given counter over all shards, 0 when metrics are compiled out
+        static uint64_t total (METRIC_COUNTER counter) {
+            uint64_t sum = 0;
+#ifndef NO_METRICS
+            std::lock_guard<std::mutex> lock(shards_mutex);
+            for (auto& shard : shards)
+                sum += shard->counters[counter];
+#else
+            (void)counter;
+#endif
+            return sum;
+        }
+        // Sets where dumps are written - "stderr" or file path (appended to), dump at exit is written only when set
+        static bool set_output (std::string target) {
+            if (target != "stderr") {
+                int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+                if (fd < 0)
+                    return false;
+                output_fd = fd;
+            }
+            else
+                output_fd = STDERR_FILENO;
+            return true;
+        }
+        // Blocks SIGUSR1 in calling thread, threads created afterwards inherit it. Has to be called before any thread starts
+        static void block_signal () {
+            sigset_t signals;
+            sigemptyset(&signals);
+            sigaddset(&signals, SIGUSR1);
+            pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        }
+        // Starts thread waiting for SIGUSR1 and dumping metrics each time it comes
+        static void start_signal_dump () {
+            std::thread([] {
+                sigset_t signals;
+                sigemptyset(&signals);
+                sigaddset(&signals, SIGUSR1);
+                int signal_number;
+                while (sigwait(&signals, &signal_number) == 0)
+                    dump("signal");
+            }).detach();
+        }
+        // Dumps at exit if output was chosen
+        static void dump_at_exit () {
+            if (output_fd >= 0)
+                dump("exit");
+        }
+        // Writes sum of all shards as single JSON object line
+        static void dump (const char* reason) {
+            std::array<uint64_t, C_COUNT> counters = {};
+            std::array<HistogramClass, H_COUNT> histograms;
+            size_t threads;
+            {
+                std::lock_guard<std::mutex> lock(shards_mutex);
+                threads = shards.size();
+                for (auto& shard : shards) {
+                    for (size_t index = 0; index < C_COUNT; ++index)
+                        counters[index] += shard->counters[index];
+                    for (size_t index = 0; index < H_COUNT; ++index)
+                        histograms[index].merge(shard->histograms[index]);
+                }
+            }
+
+            std::string line = "{\"metrics\":\"";
+            line += reason;
+            line += "\",\"timestamp_ns\":" + std::to_string(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count());
+            line += ",\"threads\":" + std::to_string(threads) + ",\"counters\":{";
+            for (size_t index = 0; index < C_COUNT; ++index) {
+                line += (index > 0) ? ",\"" : "\"";
+                line += counter_name(static_cast<METRIC_COUNTER>(index));
+                line += "\":" + std::to_string(counters[index]);
+            }
+            line += "},\"histograms\":{";
+            for (size_t index = 0; index < H_COUNT; ++index) {
+                HistogramClass& histogram = histograms[index];
+                char values[256];
+                snprintf(values, sizeof(values),
+                         "\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+                         histogram_name(static_cast<METRIC_HISTOGRAM>(index)), static_cast<unsigned long long>(histogram.count()),
+                         histogram.mean(), static_cast<unsigned long long>(histogram.percentile(50)),
+                         static_cast<unsigned long long>(histogram.percentile(90)), static_cast<unsigned long long>(histogram.percentile(99)),
+                         static_cast<unsigned long long>(histogram.percentile(99.9)), static_cast<unsigned long long>(histogram.max()));
+                line += (index > 0) ? "," : "";
+                line += values;
+            }
+            line += "},\"gauges\":{";
+            for (size_t index = 0; index < G_COUNT; ++index) {
+                line += (index > 0) ? ",\"" : "\"";
+                line += gauge_name(static_cast<METRIC_GAUGE>(index));
+                line += "\":" + std::to_string(gauges[index].load(std::memory_order_relaxed));
+            }
+            line += "}}\n";
+
+            // Stderr goes through writer thread to keep order with other output, file is written right away
+            int fd = (output_fd >= 0) ? output_fd.load() : STDERR_FILENO;
+            if (fd == STDERR_FILENO)
+                WriterClass::instance().push(fd, std::move(line));
+            else if (write(fd, line.data(), line.size()) < 0)
+                return;
+        }
+
+    private:
+        typedef struct {
+            std::array<RelaxedCounter, C_COUNT> counters;
+            std::array<SharedHistogramClass, H_COUNT> histograms;
+        } MetricsShard;
+
+        static inline std::mutex shards_mutex;
+        // Shards outlive their threads, so counts of finished threads stay in the dump
+        static inline std::vector<std::unique_ptr<MetricsShard>> shards;
+        static inline std::atomic<int> output_fd = -1;
+        // Gauges are set rarely, so they are shared by all threads instead of sharded
+        static inline std::array<std::atomic<int64_t>, G_COUNT> gauges = {};
+
+        // Shard of calling thread, created and registered by its first record
+        static MetricsShard& shard () {
+            thread_local MetricsShard* local = add_shard();
+            return *local;
+        }
+        static MetricsShard* add_shard () {
+            std::lock_guard<std::mutex> lock(shards_mutex);
+            shards.push_back(std::make_unique<MetricsShard>());
+            return shards.back().get();
+        }
+        static const char* counter_name (METRIC_COUNTER counter) {
+            switch (counter) {
+                case C_MSGS_SENT:         return "msgs_sent";
+                case C_MSGS_RECEIVED:     return "msgs_received";
+                case C_RETRANSMITS:       return "retransmits";
+                case C_SEND_TIMEOUTS:     return "send_timeouts";
+                case C_REPLY_TIMEOUTS:    return "reply_timeouts";
+                case C_DUPLICATES:        return "duplicates";
+                case C_CONFIRMS_RECEIVED: return "confirms_received";
+                case C_SEND_SYSCALLS:     return "send_syscalls";
+                case C_RECV_SYSCALLS:     return "recv_syscalls";
+                default:                  return "unknown";
+            }
+        }
+        static const char* histogram_name (METRIC_HISTOGRAM histogram) {
+            switch (histogram) {
+                case H_REPLY_WAIT:  return "reply_wait_ns";
+                case H_CONFIRM_RTT: return "confirm_rtt_ns";
+                case H_QUEUE_DEPTH: return "queue_depth";
+                default:            return "unknown";
+            }
+        }
+        static const char* gauge_name (METRIC_GAUGE gauge) {
+            switch (gauge) {
+                case G_RTO_US:    return "rto_us";
+                case G_SRTT_US:   return "srtt_us";
+                case G_RTTVAR_US: return "rttvar_us";
+                default:          return "unknown";
+            }
+        }
+};
+
+#endif // METRICSCLASS_H
\ No newline at end of file
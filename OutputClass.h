@@ -2,26 +2,127 @@
 #define OUTPUTCLASS_H
 
 #include "ConstsFile.h"
+#include "WriterClass.h"
+
+#include <charconv>
 
 using namespace std;
 
+// Format of received events output
+enum OUTPUT_MODE : uint8_t {
+    O_TEXT = 0, // Human readable lines on stdout/stderr
+    O_JSON,     // JSON object per line on stdout
+    O_BINARY    // Length-prefixed records on stdout
+};
+
+// Event types of machine readable output, protocol events use protocol message type values
+enum OUTPUT_EVENT : uint8_t {
+    E_REPLY        = 0x01,
+    E_MSG          = 0x04,
+    E_INTERNAL_ERR = 0xFD,
+    E_ERR          = 0xFE,
+    E_BYE          = 0xFF
+};
+
+// Event without msg_id (TCP or internal event)
+const int NO_MSG_ID = -1;
+
+// Receives events in place of regular output, used when many sessions share one thread (load generator)
+class EventSinkClass {
+    public:
+        virtual ~EventSinkClass () {}
+        virtual void on_event (OUTPUT_EVENT type, std::string_view display_name, std::string_view msg, bool result) = 0;
+};
+
 class OutputClass {
     public:
+        // Sets format of received events - "text", "json" or "binary", false if mode is invalid
+        static bool set_output_mode (string mode) {
+            if (mode == "text")
+                output_mode = O_TEXT;
+            else if (mode == "json")
+                output_mode = O_JSON;
+            else if (mode == "binary")
+                output_mode = O_BINARY;
+            else
+                return false;
+            return true;
+        }
+        // Sets when output is written - "line", "time:{ms}" or "size:{bytes}", false if policy is invalid
+        static bool set_flush_policy (string policy) {
+            size_t separator = policy.find(':');
+            string name = policy.substr(0, separator);
+            if (name == "line" && separator == string::npos) {
+                WriterClass::instance().set_policy(F_LINE, 0);
+                return true;
+            }
+            if (separator == string::npos || policy.find_first_not_of("0123456789", separator + 1) != string::npos ||
+                separator + 1 == policy.size())
+                return false;
+
+            size_t value = std::stoul(policy.substr(separator + 1));
+            if (name == "time")
+                WriterClass::instance().set_policy(F_TIME, value);
+            else if (name == "size")
+                WriterClass::instance().set_policy(F_SIZE, value);
+            else
+                return false;
+            return true;
+        }
+        // Redirects events of calling thread to given sink, nullptr restores regular output
+        static void set_thread_sink (EventSinkClass* sink) {
+            thread_sink = sink;
+        }
         // Output internal error
-        static void out_err_intern (string msg) {
-            cerr << string("ERR: " + msg) << endl;
+        static void out_err_intern (std::string_view msg) {
+            if (thread_sink != nullptr)
+                thread_sink->on_event(E_INTERNAL_ERR, "", msg, false);
+            else if (output_mode == O_TEXT)
+                write_parts(STDERR_FILENO, {"ERR: ", msg});
+            else
+                write_event(E_INTERNAL_ERR, "", msg, NO_MSG_ID);
         }
         // Output received ERR message from server
-        static void out_err_server (string display_name, string msg) {
-            cerr << string("ERR FROM " + display_name + ": " + msg) << endl;
+        static void out_err_server (std::string_view display_name, std::string_view msg, int msg_id = NO_MSG_ID) {
+            trace_output(E_ERR, msg_id);
+            if (thread_sink != nullptr)
+                thread_sink->on_event(E_ERR, display_name, msg, false);
+            else if (output_mode == O_TEXT)
+                write_parts(STDERR_FILENO, {"ERR FROM ", display_name, ": ", msg});
+            else
+                write_event(E_ERR, display_name, msg, msg_id);
         }
         // Output received MSG message from server
-        static void out_msg (string display_name, string msg) {
-            cout << string(display_name + ": " + msg) << endl;
+        static void out_msg (std::string_view display_name, std::string_view msg, int msg_id = NO_MSG_ID) {
+            trace_output(E_MSG, msg_id);
+            if (thread_sink != nullptr)
+                thread_sink->on_event(E_MSG, display_name, msg, false);
+            else if (output_mode == O_TEXT)
+                write_parts(STDOUT_FILENO, {display_name, ": ", msg});
+            else
+                write_event(E_MSG, display_name, msg, msg_id);
         }
         // Output received REPLY message from server
-        static void out_reply (bool result, string reason) {
-            cerr << string(((result) ? "Success: " : "Failure: ") + reason) << endl;
+        static void out_reply (bool result, std::string_view reason, int msg_id = NO_MSG_ID) {
+            trace_output(E_REPLY, msg_id);
+            if (thread_sink != nullptr)
+                thread_sink->on_event(E_REPLY, "", reason, result);
+            else if (output_mode == O_TEXT)
+                write_parts(STDERR_FILENO, {((result) ? "Success: " : "Failure: "), reason});
+            else
+                write_event(E_REPLY, "", reason, msg_id, result);
+        }
+        // Output received BYE message from server, only machine readable output reports it
+        static void out_bye (int msg_id = NO_MSG_ID) {
+            trace_output(E_BYE, msg_id);
+            if (thread_sink != nullptr)
+                thread_sink->on_event(E_BYE, "", "", false);
+            else if (output_mode != O_TEXT)
+                write_event(E_BYE, "", "", msg_id);
+        }
+        // Output line of program's own text (load generator report)
+        static void out_line (const string& line) {
+            write_line(STDOUT_FILENO, line);
         }
         // Output help about how to run the program
         static void out_help () {
@@ -31,9 +132,18 @@ class OutputClass {
             help_text += "  -s for providing IPv4 address\n";
             help_text += "  -p for specifying port\n";
             help_text += "  -d for UDP timeout [ms]\n";
-            help_text += "  -r for UDP retransmissions count";
+            help_text += "  -r for UDP retransmissions count\n";
+            help_text += "  -w for UDP send window size [msgs]\n";
+            help_text += "  -b for UDP batch size of send/receive syscalls [msgs]\n";
+            help_text += "  -e to set engine [threads/epoll/uring]\n";
+            help_text += "  -f for output flush policy [line/time:{ms}/size:{bytes}]\n";
+            help_text += "  -o for output mode [text/json/binary]\n";
+            help_text += "  -m for metrics output, dumped at exit and on SIGUSR1 [stderr/{file}]\n";
+            help_text += "  -T for message lifecycle trace file, see make trace2json [{file}]\n";
+            help_text += "  -i for scripted input file read instead of stdin without waiting for each line [{file}/-]\n";
+            help_text += "  -q for max number of outstanding messages of scripted input [1-1024, default 256]";
             // Output to stdout
-            cout << help_text << endl;
+            write_line(STDOUT_FILENO, help_text);
         }
         // Output help about available client commands to use
         static void out_help_cmds () {
@@ -44,7 +154,125 @@ class OutputClass {
             help_text += "  /rename {DisplayName} : Locally changes the display name of the user to be sent with new messages/selected commands\n";
             help_text += "  /help : Prints this help text :-)";
             // Output to stdout
-            cout << help_text << endl;
+            write_line(STDOUT_FILENO, help_text);
+        }
+
+    private:
+        static inline std::atomic<OUTPUT_MODE> output_mode = O_TEXT;
+        static inline thread_local EventSinkClass* thread_sink = nullptr;
+
+        // Events without msg_id are tied to received message by order of records of the thread
+        static void trace_output (OUTPUT_EVENT type, int msg_id) {
+            TraceClass::record(T_OUTPUT, (msg_id == NO_MSG_ID) ? 0 : static_cast<uint16_t>(msg_id), type);
+        }
+
+        // Composes whole event record in single buffer and passes it to writer thread.
+        // Timestamp is taken from monotonic clock right after event was received and parsed
+        static void write_event (OUTPUT_EVENT type, std::string_view display_name, std::string_view msg, int msg_id, bool result = false) {
+            uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+            std::string record;
+            if (output_mode == O_BINARY) {
+                // Display name and message are limited by 16-bit lengths
+                display_name = display_name.substr(0, UINT16_MAX);
+                msg = msg.substr(0, UINT16_MAX);
+                // Record length (without itself), type, flags, msg_id, timestamp, two lengths and both strings
+                uint32_t body_size = 1 + 1 + 2 + 8 + 2 + display_name.size() + 2 + msg.size();
+                record.reserve(4 + body_size);
+                put_number(record, body_size, 4);
+                put_number(record, type, 1);
+                put_number(record, (msg_id != NO_MSG_ID ? 0x01 : 0x00) | (result ? 0x02 : 0x00), 1);
+                put_number(record, (msg_id != NO_MSG_ID ? msg_id : 0), 2);
+                put_number(record, timestamp, 8);
+                put_number(record, display_name.size(), 2);
+                record.append(display_name);
+                put_number(record, msg.size(), 2);
+                record.append(msg);
+                WriterClass::instance().push(STDOUT_FILENO, std::move(record));
+                return;
+            }
+
+            // Escaped characters may need more space, common messages dont have any
+            record.reserve(128 + display_name.size() + msg.size());
+            record.append("{\"type\":\"");
+            record.append(event_name(type));
+            record.append("\",\"timestamp_ns\":");
+            put_decimal(record, timestamp);
+            record.append(",\"msg_id\":");
+            if (msg_id != NO_MSG_ID)
+                put_decimal(record, msg_id);
+            else
+                record.append("null");
+            if (type == E_REPLY)
+                record.append(result ? ",\"result\":true" : ",\"result\":false");
+            if (type == E_MSG || type == E_ERR) {
+                record.append(",\"display_name\":");
+                put_json_string(record, display_name);
+            }
+            if (type != E_BYE) {
+                record.append(",\"message\":");
+                put_json_string(record, msg);
+            }
+            record.append("}\n");
+            WriterClass::instance().push(STDOUT_FILENO, std::move(record));
+        }
+        static const char* event_name (OUTPUT_EVENT type) {
+            switch (type) {
+                case E_REPLY:        return "REPLY";
+                case E_MSG:          return "MSG";
+                case E_ERR:          return "ERR";
+                case E_BYE:          return "BYE";
+                default:             return "INTERNAL_ERR";
+            }
+        }
+        // Appends number in network byte order (big endian) using given count of bytes
+        static void put_number (std::string& record, uint64_t value, size_t bytes) {
+            for (size_t shift = bytes * 8; shift > 0; shift -= 8)
+                record.push_back(static_cast<char>((value >> (shift - 8)) & 0xFF));
+        }
+        static void put_decimal (std::string& record, uint64_t value) {
+            char digits[20];
+            char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+            record.append(digits, end - digits);
+        }
+        // Appends quoted string with JSON escaping
+        static void put_json_string (std::string& record, std::string_view value) {
+            static const char hex[] = "0123456789abcdef";
+            record.push_back('"');
+            for (char letter : value) {
+                uint8_t code = static_cast<uint8_t>(letter);
+                if (letter == '"' || letter == '\\') {
+                    record.push_back('\\');
+                    record.push_back(letter);
+                }
+                else if (code < 0x20 || code == 0x7F) {
+                    record.append("\\u00");
+                    record.push_back(hex[code >> 4]);
+                    record.push_back(hex[code & 0x0F]);
+                }
+                else
+                    record.push_back(letter);
+            }
+            record.push_back('"');
+        }
+        // Passes line to writer thread, which keeps order of lines across stdout and stderr
+        static void write_line (int fd, string line) {
+            line += '\n';
+            WriterClass::instance().push(fd, std::move(line));
+        }
+        // Composes line from given parts in single allocation and passes it to writer thread
+        static void write_parts (int fd, std::initializer_list<std::string_view> parts) {
+            size_t line_size = 1;
+            for (std::string_view part : parts)
+                line_size += part.size();
+
+            std::string line;
+            line.reserve(line_size);
+            for (std::string_view part : parts)
+                line.append(part);
+            line += '\n';
+            WriterClass::instance().push(fd, std::move(line));
         }
 };
 
@@ -0,0 +1,76 @@
+#ifndef RTTCLASS_H
+#define RTTCLASS_H
+
+#include "ConstsFile.h"
+#include "MetricsClass.h"
+
+// Estimates retransmission timeout from measured send-to-CONFIRM times (SRTT/RTTVAR with Karn's algorithm)
+class RTTClass {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        RTTClass ()
+        : rto_us    (0),
+          srtt_us   (0),
+          rttvar_us (0),
+          min_rto   (0),
+          max_rto   (0)
+        {
+        }
+
+        // Sets initial timeout, estimated timeout is then kept between 1/4 (at least 1 ms) and 8 times of it
+        void init (std::chrono::milliseconds initial) {
+            std::chrono::microseconds initial_us = initial;
+            this->rto_us    = initial_us.count();
+            this->srtt_us   = 0;
+            this->rttvar_us = 0;
+            this->min_rto   = std::max<int64_t>(initial_us.count() / 4, 1000/*1 ms*/);
+            this->max_rto   = initial_us.count() * 8;
+            publish();
+        }
+        // Samples round trip time of message first sent at given time and updates timeout. Retransmitted message
+        // has no send time, its confirmation is ambiguous so it isnt sampled (Karn's algorithm)
+        void confirmed (clock::time_point sent_at) {
+            if (sent_at == clock::time_point())
+                return;
+            MetricsClass::record_since(H_CONFIRM_RTT, sent_at);
+            int64_t sample = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - sent_at).count();
+
+            if (this->srtt_us == 0) { // First measurement
+                this->srtt_us   = sample;
+                this->rttvar_us = sample / 2;
+            }
+            else {
+                this->rttvar_us = (3 * this->rttvar_us + std::abs(this->srtt_us - sample)) / 4;
+                this->srtt_us   = (7 * this->srtt_us + sample) / 8;
+            }
+            this->rto_us = std::clamp<int64_t>(this->srtt_us + 4 * this->rttvar_us, this->min_rto, this->max_rto);
+            publish();
+        }
+        // Timeout expired, double the timeout till next successful measurement
+        void backoff () {
+            this->rto_us = std::min<int64_t>(this->rto_us * 2, this->max_rto);
+            publish();
+        }
+        // Getter for current retransmission timeout
+        std::chrono::microseconds get_rto () {
+            return std::chrono::microseconds(this->rto_us);
+        }
+
+    private:
+        // Atomic to allow reading current estimate from other threads
+        std::atomic<int64_t> rto_us;
+        std::atomic<int64_t> srtt_us;
+        std::atomic<int64_t> rttvar_us;
+        int64_t min_rto;
+        int64_t max_rto;
+
+        // Current estimate goes to metrics dump, SRTT is zero until first measurement
+        void publish () {
+            MetricsClass::set(G_RTO_US, this->rto_us);
+            MetricsClass::set(G_SRTT_US, this->srtt_us);
+            MetricsClass::set(G_RTTVAR_US, this->rttvar_us);
+        }
+};
+
+#endif // RTTCLASS_H
\ No newline at end of file
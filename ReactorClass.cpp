@@ -0,0 +1,195 @@
+#include "ReactorClass.h"
+
+ReactorClass::ReactorClass (ClientClass* client, BatchInputClass* batch, uint32_t batch_limit, sigset_t interrupt_signals)
+    : client             (client),
+      batch              (batch),
+      batch_limit        (batch_limit),
+      epoll_fd           (-1),
+      timer_fd           (-1),
+      interrupt_signals  (interrupt_signals),
+      signal_fd          (-1),
+      input_data         (""),
+      input_always_ready (false),
+      input_eof          (false),
+      wait_for_input     (false),
+      bye_sent           (false)
+{
+}
+
+ReactorClass::~ReactorClass () {
+    if (this->signal_fd >= 0)
+        close(this->signal_fd);
+    if (this->timer_fd >= 0)
+        close(this->timer_fd);
+    if (this->epoll_fd >= 0)
+        close(this->epoll_fd);
+}
+/***********************************************************************************/
+void ReactorClass::run () {
+    if ((this->epoll_fd = epoll_create1(0)) < 0)
+        throw std::logic_error("Epoll instance creation failed");
+
+    if ((this->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) < 0)
+        throw std::logic_error("Timer creation failed");
+
+    if ((this->signal_fd = signalfd(-1, &this->interrupt_signals, SFD_NONBLOCK)) < 0)
+        throw std::logic_error("Interrupt signal descriptor creation failed");
+
+    // Watch client socket, timer for client deadlines and interrupt signal
+    for (int watched_fd : {this->client->get_socket(), this->timer_fd, this->signal_fd}) {
+        struct epoll_event event = {
+            .events = EPOLLIN,
+            .data = {.fd = watched_fd}
+        };
+        if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, watched_fd, &event) < 0)
+            throw std::logic_error("Adding descriptor to epoll instance failed");
+    }
+
+    // Watch user input, regular file (redirected input) cant be watched but it is always readable
+    struct epoll_event input_event = {
+        .events = EPOLLIN,
+        .data = {.fd = STDIN_FILENO}
+    };
+    // Scripted input is already loaded
+    if (this->batch == nullptr && epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &input_event) < 0) {
+        if (errno != EPERM)
+            throw std::logic_error("Adding user input to epoll instance failed");
+        this->input_always_ready = true;
+    }
+
+    struct epoll_event events[4];
+    while (this->client->stop_program() == false) {
+        // Pass user input to client and send whatever can be sent
+        process_input();
+        this->client->send_pending();
+        if (this->client->stop_program() == true)
+            break;
+
+        arm_timer();
+        // Dont block when there is more user input client is ready to take
+        int events_count = epoll_wait(this->epoll_fd, events, 4, (input_ready() ? 0 : -1));
+        if (events_count < 0) {
+            // Interrupted by signal, interrupt signal itself is read from its descriptor
+            if (errno == EINTR)
+                continue;
+            throw std::logic_error("Waiting for events failed");
+        }
+
+        for (int index = 0; index < events_count && this->client->stop_program() == false; ++index) {
+            int ready_fd = events[index].data.fd;
+            if (ready_fd == this->timer_fd) {
+                // Clear timer expiration, deadlines are handled when sending
+                uint64_t expirations;
+                if (read(this->timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+                    OutputClass::out_err_intern("Error while reading timer");
+            }
+            else if (ready_fd == this->signal_fd)
+                read_interrupt();
+            else if (ready_fd == STDIN_FILENO)
+                read_input();
+            else
+                this->client->receive_pending();
+        }
+    }
+}
+/***********************************************************************************/
+void ReactorClass::read_input () {
+    char in_buffer[MAXLENGTH];
+    ssize_t bytes_read = read(STDIN_FILENO, in_buffer, MAXLENGTH);
+
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+
+    if (bytes_read <= 0) { // EOF (or error) - stop watching user input
+        this->input_eof = true;
+        if (this->input_always_ready == false)
+            epoll_ctl(this->epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, nullptr);
+        return;
+    }
+    this->input_data.append(in_buffer, bytes_read);
+}
+/***********************************************************************************/
+void ReactorClass::read_interrupt () {
+    struct signalfd_siginfo info;
+    if (read(this->signal_fd, &info, sizeof(info)) != sizeof(info)) {
+        if (errno != EAGAIN)
+            OutputClass::out_err_intern("Error while reading interrupt signal");
+        return;
+    }
+    // BYE is sent in next iteration together with anything else pending
+    this->client->send_priority_bye();
+}
+/***********************************************************************************/
+void ReactorClass::process_input () {
+    if (this->batch != nullptr) {
+        // Keep outstanding messages up to the limit, end session once everything was passed
+        this->batch->feed(this->client, this->batch_limit);
+        if (this->batch->done() == true && this->bye_sent == false) {
+            this->bye_sent = true;
+            this->client->send_bye();
+        }
+        return;
+    }
+    while (this->client->stop_program() == false) {
+        // Previous line is still being processed by client
+        if (this->wait_for_input == true) {
+            if (this->client->load_user_input() == false)
+                return;
+            this->client->set_load_user_input(false);
+            this->wait_for_input = false;
+        }
+
+        size_t line_end = this->input_data.find('\n');
+        if (line_end == std::string::npos) {
+            // Load more from regular file right away
+            if (this->input_always_ready == true && this->input_eof == false) {
+                read_input();
+                continue;
+            }
+            if (this->input_eof == true) {
+                // Last line without line ending
+                if (this->input_data.empty() == false) {
+                    std::string user_line = std::move(this->input_data);
+                    this->input_data.clear();
+                    this->wait_for_input = this->client->process_user_line(user_line, true);
+                    continue;
+                }
+                // User EOF event
+                if (this->bye_sent == false) {
+                    this->bye_sent = true;
+                    this->client->send_bye();
+                }
+            }
+            return;
+        }
+
+        std::string user_line = this->input_data.substr(0, line_end);
+        this->input_data.erase(0, line_end + 1);
+        this->wait_for_input = this->client->process_user_line(user_line, false);
+    }
+}
+/***********************************************************************************/
+bool ReactorClass::input_ready () {
+    if (this->batch != nullptr)
+        return (this->batch->done() == false && this->client->outstanding() < this->batch_limit);
+    if (this->wait_for_input == true && this->client->load_user_input() == false)
+        return false;
+    return (this->input_data.find('\n') != std::string::npos ||
+            (this->input_always_ready == true && this->input_eof == false) ||
+            (this->input_eof == true && this->bye_sent == false));
+}
+/***********************************************************************************/
+void ReactorClass::arm_timer () {
+    // Zero value disarms the timer
+    struct itimerspec timer_spec = {};
+    std::chrono::steady_clock::time_point deadline;
+    if (this->client->next_deadline(deadline) == true) {
+        // Steady clock is monotonic clock, so deadline can be used as absolute time
+        int64_t deadline_ns = std::max<int64_t>(1,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count());
+        timer_spec.it_value.tv_sec  = deadline_ns / 1000000000;
+        timer_spec.it_value.tv_nsec = deadline_ns % 1000000000;
+    }
+    if (timerfd_settime(this->timer_fd, TFD_TIMER_ABSTIME, &timer_spec, nullptr) < 0)
+        OutputClass::out_err_intern("Error while setting timer");
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef REACTORCLASS_H
+#define REACTORCLASS_H
+
+#include "ClientClass.h"
+#include "BatchInputClass.h"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+// Single-threaded event loop engine multiplexing user input, client socket and client deadlines on one epoll instance
+class ReactorClass {
+    private:
+        ClientClass* client;
+        // Scripted input used instead of stdin, nullptr for interactive input
+        BatchInputClass* batch;
+        uint32_t batch_limit;
+
+        int epoll_fd;
+        int timer_fd;
+        // Interrupt signal (CTRL+C) blocked in the thread, it is read from descriptor like any other event
+        sigset_t interrupt_signals;
+        int signal_fd;
+
+        // User input read from stdin, not processed yet
+        std::string input_data;
+        // Stdin is regular file which cant be watched by epoll, it is always readable
+        bool input_always_ready;
+        bool input_eof;
+        // Last passed line is still being processed by client
+        bool wait_for_input;
+        bool bye_sent;
+
+        void read_input ();
+        void read_interrupt ();
+        void process_input ();
+        void arm_timer ();
+        bool input_ready ();
+
+    public:
+        ReactorClass (ClientClass* client, BatchInputClass* batch, uint32_t batch_limit, sigset_t interrupt_signals);
+        ~ReactorClass ();
+        // Runs the event loop till client ends the session
+        void run ();
+};
+
+#endif // REACTORCLASS_H
\ No newline at end of file
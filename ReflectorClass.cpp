@@ -0,0 +1,753 @@
+#include "ReflectorClass.h"
+
+// Datagrams received or sent by single recvmmsg/sendmmsg
+#define UDP_BATCH 32
+// Max number of MSGs sent to one client at once, so blasting client cant starve others
+#define MAX_MSGS_PER_SERVE 64
+// TCP output of one client is written before more MSGs are composed for it
+#define TCP_HIGH_WATER (64 * 1024)
+
+// TCP clients are keyed by their socket with this bit set, UDP keys use only lower 48 bits
+const uint64_t TCP_KEY    = 1ULL << 63;
+// Keys of worker's own descriptors in epoll
+const uint64_t STOP_KEY   = UINT64_MAX;
+const uint64_t TIMER_KEY  = UINT64_MAX - 1;
+const uint64_t UDP_KEY    = UINT64_MAX - 2;
+const uint64_t LISTEN_KEY = UINT64_MAX - 3;
+
+// Written by signal handler to stop all workers
+int reflector_stop_fd = -1;
+
+void stop_handler (int sig_val) {
+    (void)sig_val;
+    uint64_t value = 1;
+    if (write(reflector_stop_fd, &value, sizeof(value)) < 0)
+        return;
+}
+
+ReflectorWorkerClass::ReflectorWorkerClass (const ReflectorConfig& config, ReflectorStats& stats, int stop_fd)
+    : config    (config),
+      stats     (stats),
+      stop_fd   (stop_fd),
+      epoll_fd  (-1),
+      timer_fd  (-1),
+      udp_fd    (-1),
+      listen_fd (-1),
+      in_buffers  (UDP_BATCH * MAXLENGTH),
+      in_addrs    (UDP_BATCH),
+      in_iovs     (UDP_BATCH),
+      in_msgs     (UDP_BATCH),
+      out_buffers (UDP_BATCH * MAXLENGTH),
+      out_addrs   (UDP_BATCH),
+      out_iovs    (UDP_BATCH),
+      out_msgs    (UDP_BATCH),
+      out_count   (0)
+{
+    // Each datagram of the batch has its own buffer and address
+    for (size_t index = 0; index < UDP_BATCH; ++index) {
+        this->in_iovs[index].iov_base = this->in_buffers.data() + index * MAXLENGTH;
+        this->in_iovs[index].iov_len  = MAXLENGTH;
+        this->in_msgs[index].msg_hdr.msg_iov    = &this->in_iovs[index];
+        this->in_msgs[index].msg_hdr.msg_iovlen = 1;
+        this->in_msgs[index].msg_hdr.msg_name   = &this->in_addrs[index];
+
+        this->out_iovs[index].iov_base = this->out_buffers.data() + index * MAXLENGTH;
+        this->out_msgs[index].msg_hdr.msg_iov     = &this->out_iovs[index];
+        this->out_msgs[index].msg_hdr.msg_iovlen  = 1;
+        this->out_msgs[index].msg_hdr.msg_name    = &this->out_addrs[index];
+        this->out_msgs[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+
+    // Bind sockets right away, so port in use is reported before any worker starts
+    this->udp_fd = open_socket(SOCK_DGRAM);
+    this->listen_fd = open_socket(SOCK_STREAM);
+}
+
+ReflectorWorkerClass::~ReflectorWorkerClass () {
+    for (auto& [key, peer] : this->peers) {
+        if (peer.fd >= 0)
+            close(peer.fd);
+    }
+    for (int fd : {this->epoll_fd, this->timer_fd, this->udp_fd, this->listen_fd}) {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+/***********************************************************************************/
+int ReflectorWorkerClass::open_socket (int type) {
+    // Listener doesnt block on accept, UDP socket blocks only when sending (loopback is never slow for long)
+    int socket_id = socket(AF_INET, type | ((type == SOCK_STREAM) ? SOCK_NONBLOCK : 0), 0);
+    if (socket_id < 0)
+        throw std::logic_error("Error creating socket");
+
+    // All workers bind the same port, kernel spreads clients among them
+    int enable = 1;
+    setsockopt(socket_id, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    setsockopt(socket_id, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+    if (type == SOCK_DGRAM) {
+        // Large buffers keep blasts and bursts from many clients from being dropped
+        int buffer_size = 4 * 1024 * 1024;
+        setsockopt(socket_id, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+        setsockopt(socket_id, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    }
+
+    if (bind(socket_id, (struct sockaddr*)&this->config.address, sizeof(this->config.address)) < 0) {
+        close(socket_id);
+        throw std::logic_error("Error binding socket, port may be in use");
+    }
+    if (type == SOCK_STREAM && listen(socket_id, SOMAXCONN) < 0) {
+        close(socket_id);
+        throw std::logic_error("Error listening on socket");
+    }
+    return socket_id;
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::run () {
+    if ((this->epoll_fd = epoll_create1(0)) < 0)
+        throw std::logic_error("Epoll instance creation failed");
+
+    if ((this->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) < 0)
+        throw std::logic_error("Timer creation failed");
+
+    std::pair<int, uint64_t> watched[] = {
+        {this->stop_fd, STOP_KEY}, {this->timer_fd, TIMER_KEY}, {this->udp_fd, UDP_KEY}, {this->listen_fd, LISTEN_KEY}
+    };
+    for (auto [watched_fd, key] : watched) {
+        struct epoll_event event = {
+            .events = EPOLLIN,
+            .data = {.u64 = key}
+        };
+        if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, watched_fd, &event) < 0)
+            throw std::logic_error("Adding descriptor to epoll instance failed");
+    }
+
+    struct epoll_event events[64];
+    std::vector<uint64_t> serving;
+    while (true) {
+        // Send MSGs of clients whose send rate allows it, the rest tells when to wake up
+        clock::time_point now = clock::now();
+        clock::time_point wake = clock::time_point::max();
+        serving.swap(this->pending);
+        this->pending.clear();
+        for (uint64_t key : serving) {
+            auto peer = this->peers.find(key);
+            // Client is gone or listed more than once
+            if (peer == this->peers.end() || peer->second.pending == false)
+                continue;
+            peer->second.pending = false;
+            clock::time_point next = serve(peer->second, now);
+            if (next != clock::time_point::max()) {
+                schedule(key, peer->second);
+                wake = std::min(wake, next);
+            }
+        }
+        flush_udp();
+
+        // Zero value disarms the timer, steady clock is monotonic clock so wake can be used as absolute time
+        struct itimerspec timer_spec = {};
+        if (wake != clock::time_point::max() && wake > now) {
+            int64_t wake_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count();
+            timer_spec.it_value.tv_sec  = wake_ns / 1000000000;
+            timer_spec.it_value.tv_nsec = wake_ns % 1000000000;
+        }
+        if (timerfd_settime(this->timer_fd, TFD_TIMER_ABSTIME, &timer_spec, nullptr) < 0)
+            OutputClass::out_err_intern("Error while setting timer");
+
+        int events_count = epoll_wait(this->epoll_fd, events, 64, (wake <= now ? 0 : -1));
+        if (events_count < 0) {
+            // Interrupted by signal, stop request is seen in next iteration
+            if (errno == EINTR)
+                continue;
+            throw std::logic_error("Waiting for events failed");
+        }
+
+        for (int index = 0; index < events_count; ++index) {
+            uint64_t key = events[index].data.u64;
+            if (key == STOP_KEY)
+                return;
+            else if (key == TIMER_KEY) {
+                // Clear timer expiration, clients are served at the loop start
+                uint64_t expirations;
+                if (read(this->timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+                    OutputClass::out_err_intern("Error while reading timer");
+            }
+            else if (key == UDP_KEY)
+                receive_udp();
+            else if (key == LISTEN_KEY)
+                accept_tcp();
+            else {
+                auto peer = this->peers.find(key);
+                if (peer == this->peers.end())
+                    continue;
+                // Written output may let queued MSGs go or finish leaving client
+                if (events[index].events & EPOLLOUT) {
+                    if (flush_tcp(peer->second) == true && peer->second.leaving == true) {
+                        close_peer(key);
+                        continue;
+                    }
+                    schedule(key, peer->second);
+                }
+                if (events[index].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    receive_tcp(key, peer->second);
+            }
+        }
+    }
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::receive_udp () {
+    // Take few batches at most, level triggered epoll reports the rest again
+    for (size_t round = 0; round < 8; ++round) {
+        for (size_t index = 0; index < UDP_BATCH; ++index)
+            this->in_msgs[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+
+        int msgs_received = recvmmsg(this->udp_fd, this->in_msgs.data(), UDP_BATCH, MSG_DONTWAIT, nullptr);
+        if (msgs_received <= 0)
+            return;
+
+        for (int index = 0; index < msgs_received; ++index) {
+            const struct sockaddr_in& addr = this->in_addrs[index];
+            uint64_t key = (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+            handle_udp(key, std::string_view(static_cast<char*>(this->in_iovs[index].iov_base), this->in_msgs[index].msg_len), addr);
+        }
+        if (msgs_received < UDP_BATCH)
+            return;
+    }
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::handle_udp (uint64_t key, std::string_view datagram, const struct sockaddr_in& addr) {
+    // Header is needed at least to confirm the message
+    if (datagram.size() < 3) {
+        ++this->stats.malformed;
+        return;
+    }
+    uint8_t type = static_cast<uint8_t>(datagram[0]);
+    uint16_t msg_id = (static_cast<uint8_t>(datagram[1]) << 8) | static_cast<uint8_t>(datagram[2]);
+    if (type == CONFIRM) {
+        ++this->stats.confirms_received;
+        return;
+    }
+
+    auto [iter, created] = this->peers.try_emplace(key);
+    ReflectorPeer& peer = iter->second;
+    if (created == true) {
+        peer.addr = addr;
+        ++this->stats.clients;
+    }
+
+    // Every copy is confirmed, but only the first one is answered
+    send_confirm(peer, msg_id);
+    if (peer.seen.check_and_mark(msg_id) == true) {
+        ++this->stats.duplicates;
+        return;
+    }
+    ++this->stats.received;
+
+    // Null terminated parts following the header
+    std::string_view parts[3];
+    size_t parts_count = 0;
+    std::string_view rest = datagram.substr(3);
+    while (parts_count < 3 && rest.empty() == false) {
+        size_t end = rest.find('\0');
+        if (end == std::string_view::npos)
+            break;
+        parts[parts_count++] = rest.substr(0, end);
+        rest.remove_prefix(end + 1);
+    }
+
+    bool valid = true;
+    switch (type) {
+        case AUTH: // Username, DisplayName, Secret
+            if ((valid = (parts_count == 3)) == true) {
+                send_reply(peer, msg_id, "Auth success.");
+                start_session(key, peer);
+            }
+            break;
+        case JOIN: // ChannelID, DisplayName
+            if ((valid = (parts_count == 2)) == true)
+                send_reply(peer, msg_id, "Join success.");
+            break;
+        case MSG: // DisplayName, MessageContents
+            if ((valid = (parts_count == 2)) == true)
+                handle_msg(key, peer, parts[0], parts[1]);
+            break;
+        case ERR: // Client ends with error, say BYE and forget it
+            send_bye(peer);
+            close_peer(key);
+            break;
+        case BYE:
+            close_peer(key);
+            break;
+        default:
+            valid = false;
+            break;
+    }
+    if (valid == false) {
+        ++this->stats.malformed;
+        send_err(peer, "Malformed message");
+        send_bye(peer);
+        close_peer(key);
+    }
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::accept_tcp () {
+    while (true) {
+        int socket_id = accept4(this->listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (socket_id < 0)
+            return;
+
+        // Replies are small and latency matters more than packet count
+        int enable = 1;
+        setsockopt(socket_id, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        uint64_t key = TCP_KEY | static_cast<uint64_t>(socket_id);
+        struct epoll_event event = {
+            .events = EPOLLIN,
+            .data = {.u64 = key}
+        };
+        if (epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, socket_id, &event) < 0) {
+            OutputClass::out_err_intern("Adding descriptor to epoll instance failed");
+            close(socket_id);
+            continue;
+        }
+        ReflectorPeer& peer = this->peers[key];
+        peer.fd = socket_id;
+        peer.framer = std::make_unique<FramerClass>();
+        ++this->stats.clients;
+    }
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::receive_tcp (uint64_t key, ReflectorPeer& peer) {
+    while (peer.leaving == false) {
+        size_t space = peer.framer->write_space();
+        // Frame longer than whole buffer
+        if (space == 0) {
+            ++this->stats.malformed;
+            close_peer(key);
+            return;
+        }
+        ssize_t bytes_rx = recv(peer.fd, peer.framer->write_ptr(), space, 0);
+        if (bytes_rx < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        // Connection closed by client or broken
+        if (bytes_rx <= 0) {
+            close_peer(key);
+            return;
+        }
+        peer.framer->commit(bytes_rx);
+
+        std::string_view frame;
+        while (peer.leaving == false && peer.framer->next_frame(frame) == true) {
+            if (handle_tcp(key, peer, frame) == false)
+                return;
+        }
+        // Socket is drained
+        if (static_cast<size_t>(bytes_rx) < space)
+            break;
+    }
+    // Answer right away, leaving client is closed once everything is written
+    if (flush_tcp(peer) == true && peer.leaving == true)
+        close_peer(key);
+}
+/***********************************************************************************/
+bool ReflectorWorkerClass::handle_tcp (uint64_t key, ReflectorPeer& peer, std::string_view frame) {
+    // Split off message type first, it decides how many fields the rest consists of
+    std::string_view fields[6];
+    size_t fields_count = TokenizerClass::split(frame, fields, 2, ' ');
+    auto split_rest = [&](size_t max_fields) {
+        if (fields_count == 2)
+            fields_count = 1 + TokenizerClass::split(fields[1], fields + 1, max_fields - 1, ' ');
+    };
+    ++this->stats.received;
+
+    bool valid = false;
+    switch (TokenizerClass::msg_type(fields[0])) {
+        case AUTH: // AUTH {Username} AS {DisplayName} USING {Secret}
+            split_rest(6);
+            if ((valid = (fields_count == 6 && TokenizerClass::is_keyword(fields[2], "AS") &&
+                          TokenizerClass::is_keyword(fields[4], "USING"))) == true) {
+                send_reply(peer, 0, "Auth success.");
+                start_session(key, peer);
+            }
+            break;
+        case JOIN: // JOIN {ChannelID} AS {DisplayName}
+            split_rest(4);
+            if ((valid = (fields_count == 4 && TokenizerClass::is_keyword(fields[2], "AS"))) == true)
+                send_reply(peer, 0, "Join success.");
+            break;
+        case MSG: // MSG FROM {DisplayName} IS {MessageContent}
+            split_rest(5);
+            if ((valid = (fields_count == 5 && TokenizerClass::is_keyword(fields[1], "FROM") &&
+                          TokenizerClass::is_keyword(fields[3], "IS"))) == true)
+                handle_msg(key, peer, fields[2], fields[4]);
+            break;
+        case ERR: // Client ends with error, say BYE and close
+            valid = true;
+            send_bye(peer);
+            peer.leaving = true;
+            break;
+        case BYE: // Answers to earlier messages are still written
+            flush_tcp(peer);
+            close_peer(key);
+            return false;
+        default:
+            break;
+    }
+    if (valid == false) {
+        ++this->stats.malformed;
+        send_err(peer, "Malformed message");
+        send_bye(peer);
+        peer.leaving = true;
+    }
+    if (peer.leaving == true) {
+        // Nothing more is sent to leaving client
+        peer.echoes.clear();
+        peer.blast_left = 0;
+    }
+    return true;
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::handle_msg (uint64_t key, ReflectorPeer& peer, std::string_view display_name, std::string_view content) {
+    if (this->config.mode == R_SINK)
+        return;
+
+    // Echo right away unless it would overtake queued MSGs or exceed send rate
+    bool tcp_full = (peer.fd >= 0 && peer.out_data.size() - peer.out_pos >= TCP_HIGH_WATER);
+    if (peer.echoes.empty() == true && tcp_full == false && rate_allows(peer, clock::now()) == true) {
+        send_msg(peer, display_name, content);
+        return;
+    }
+    peer.echoes.push_back({std::string(display_name), std::string(content)});
+    schedule(key, peer);
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::start_session (uint64_t key, ReflectorPeer& peer) {
+    if (this->config.blast_count == 0 || peer.blast_left > 0)
+        return;
+    peer.blast_left = this->config.blast_count;
+    schedule(key, peer);
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::schedule (uint64_t key, ReflectorPeer& peer) {
+    if (peer.pending == true || (peer.echoes.empty() == true && peer.blast_left == 0))
+        return;
+    peer.pending = true;
+    this->pending.push_back(key);
+}
+/***********************************************************************************/
+ReflectorWorkerClass::clock::time_point ReflectorWorkerClass::serve (ReflectorPeer& peer, clock::time_point now) {
+    // Batch limit reached, continue right in next loop iteration
+    clock::time_point wake = now;
+    for (size_t sent = 0; sent < MAX_MSGS_PER_SERVE; ++sent) {
+        if (peer.echoes.empty() == true && peer.blast_left == 0) {
+            wake = clock::time_point::max();
+            break;
+        }
+        // Writable socket schedules client again
+        if (peer.fd >= 0 && peer.out_data.size() - peer.out_pos >= TCP_HIGH_WATER && flush_tcp(peer) == false) {
+            wake = clock::time_point::max();
+            break;
+        }
+        if (rate_allows(peer, now) == false) {
+            wake = peer.next_send;
+            break;
+        }
+
+        if (peer.echoes.empty() == false) {
+            send_msg(peer, peer.echoes.front().display_name, peer.echoes.front().content);
+            peer.echoes.pop_front();
+        }
+        else
+            send_blast(peer);
+    }
+    if (peer.fd >= 0)
+        flush_tcp(peer);
+    return wake;
+}
+/***********************************************************************************/
+bool ReflectorWorkerClass::rate_allows (ReflectorPeer& peer, clock::time_point now) {
+    clock::duration interval = this->config.send_interval;
+    if (interval == clock::duration::zero())
+        return true;
+    if (peer.next_send > now)
+        return false;
+    // Keep the pace when woken up a bit late, start over after idle time
+    peer.next_send = (peer.next_send + interval < now) ? now + interval : peer.next_send + interval;
+    return true;
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::send_confirm (ReflectorPeer& peer, uint16_t ref_msg_id) {
+    size_t out_size;
+    char* buffer = udp_slot(peer, CONFIRM, out_size);
+    put_msg_id(buffer, out_size, ref_msg_id);
+    udp_commit(out_size);
+    ++this->stats.confirms_sent;
+}
+
+void ReflectorWorkerClass::send_reply (ReflectorPeer& peer, uint16_t ref_msg_id, std::string_view content) {
+    ++this->stats.replies_sent;
+    if (peer.fd >= 0) {
+        put_text(peer, {"REPLY OK IS ", content});
+        return;
+    }
+    size_t out_size;
+    char* buffer = udp_slot(peer, REPLY, out_size);
+    buffer[out_size++] = 1;
+    put_msg_id(buffer, out_size, ref_msg_id);
+    put_msg_part(buffer, out_size, content);
+    udp_commit(out_size);
+}
+
+void ReflectorWorkerClass::send_msg (ReflectorPeer& peer, std::string_view display_name, std::string_view content) {
+    ++this->stats.msgs_sent;
+    if (peer.fd >= 0) {
+        put_text(peer, {"MSG FROM ", display_name, " IS ", content});
+        return;
+    }
+    size_t out_size;
+    char* buffer = udp_slot(peer, MSG, out_size);
+    put_msg_part(buffer, out_size, display_name);
+    put_msg_part(buffer, out_size, content);
+    udp_commit(out_size);
+}
+
+void ReflectorWorkerClass::send_blast (ReflectorPeer& peer) {
+    // Content carries sequence number and monotonic send time, the rest is padding
+    uint64_t send_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+    char content[MAXLENGTH];
+    int content_size = snprintf(content, sizeof(content), "blast %llu %llu ",
+                                static_cast<unsigned long long>(peer.blast_seq), static_cast<unsigned long long>(send_ns));
+    if (static_cast<size_t>(content_size) < this->config.blast_size) {
+        std::memset(content + content_size, 'x', this->config.blast_size - content_size);
+        content_size = this->config.blast_size;
+    }
+    send_msg(peer, "Server", std::string_view(content, content_size));
+    ++peer.blast_seq;
+    --peer.blast_left;
+}
+
+void ReflectorWorkerClass::send_err (ReflectorPeer& peer, std::string_view content) {
+    if (peer.fd >= 0) {
+        put_text(peer, {"ERR FROM Server IS ", content});
+        return;
+    }
+    size_t out_size;
+    char* buffer = udp_slot(peer, ERR, out_size);
+    put_msg_part(buffer, out_size, "Server");
+    put_msg_part(buffer, out_size, content);
+    udp_commit(out_size);
+}
+
+void ReflectorWorkerClass::send_bye (ReflectorPeer& peer) {
+    if (peer.fd >= 0) {
+        put_text(peer, {"BYE"});
+        return;
+    }
+    size_t out_size;
+    udp_slot(peer, BYE, out_size);
+    udp_commit(out_size);
+}
+/***********************************************************************************/
+char* ReflectorWorkerClass::udp_slot (ReflectorPeer& peer, uint8_t type, size_t& out_size) {
+    if (this->out_count == UDP_BATCH)
+        flush_udp();
+    // Address is copied, client may be forgotten before the batch is sent
+    this->out_addrs[this->out_count] = peer.addr;
+    char* buffer = static_cast<char*>(this->out_iovs[this->out_count].iov_base);
+    out_size = 0;
+    buffer[out_size++] = static_cast<char>(type);
+    if (type != CONFIRM)
+        put_msg_id(buffer, out_size, peer.msg_id++);
+    return buffer;
+}
+
+void ReflectorWorkerClass::udp_commit (size_t out_size) {
+    this->out_iovs[this->out_count++].iov_len = out_size;
+}
+
+void ReflectorWorkerClass::flush_udp () {
+    size_t sent_count = 0;
+    while (sent_count < this->out_count) {
+        int result = sendmmsg(this->udp_fd, this->out_msgs.data() + sent_count, this->out_count - sent_count, 0);
+        if (result < 0 && errno == EINTR)
+            continue;
+        // Skip datagram kernel refused to send
+        sent_count += (result <= 0) ? 1 : result;
+    }
+    this->out_count = 0;
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::put_text (ReflectorPeer& peer, std::initializer_list<std::string_view> parts) {
+    for (std::string_view part : parts)
+        peer.out_data.append(part);
+    peer.out_data.append("\r\n");
+}
+
+bool ReflectorWorkerClass::flush_tcp (ReflectorPeer& peer) {
+    while (peer.out_pos < peer.out_data.size()) {
+        ssize_t bytes_tx = send(peer.fd, peer.out_data.data() + peer.out_pos, peer.out_data.size() - peer.out_pos, MSG_NOSIGNAL);
+        if (bytes_tx < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Wait till socket is writable again
+            if (peer.want_write == false) {
+                peer.want_write = true;
+                struct epoll_event event = {
+                    .events = EPOLLIN | EPOLLOUT,
+                    .data = {.u64 = TCP_KEY | static_cast<uint64_t>(peer.fd)}
+                };
+                epoll_ctl(this->epoll_fd, EPOLL_CTL_MOD, peer.fd, &event);
+            }
+            return false;
+        }
+        // Broken connection is closed once its socket reports it
+        if (bytes_tx < 0)
+            break;
+        peer.out_pos += bytes_tx;
+    }
+    peer.out_data.clear();
+    peer.out_pos = 0;
+    if (peer.want_write == true) {
+        peer.want_write = false;
+        struct epoll_event event = {
+            .events = EPOLLIN,
+            .data = {.u64 = TCP_KEY | static_cast<uint64_t>(peer.fd)}
+        };
+        epoll_ctl(this->epoll_fd, EPOLL_CTL_MOD, peer.fd, &event);
+    }
+    return true;
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::close_peer (uint64_t key) {
+    auto peer = this->peers.find(key);
+    if (peer == this->peers.end())
+        return;
+    // Closing socket removes it from epoll instance as well
+    if (peer->second.fd >= 0)
+        close(peer->second.fd);
+    this->peers.erase(peer);
+}
+/***********************************************************************************/
+void ReflectorWorkerClass::put_msg_id (char* output, size_t& output_pos, uint16_t msg_id) {
+    // Store the individual bytes in network order
+    output[output_pos++] = static_cast<char>((msg_id >> 8) & 0xFF);
+    output[output_pos++] = static_cast<char>(msg_id & 0xFF);
+}
+
+void ReflectorWorkerClass::put_msg_part (char* output, size_t& output_pos, std::string_view part) {
+    // Echoed parts came in datagram of the same size, so they always fit
+    std::memcpy(output + output_pos, part.data(), part.size());
+    output_pos += part.size();
+    // Terminate with null byte
+    output[output_pos++] = '\0';
+}
+/***********************************************************************************/
+ReflectorClass::ReflectorClass (std::map<std::string, std::string> data_map)
+    : threads_count (1)
+{
+    std::string address = "127.0.0.1";
+    uint16_t port = 4567;
+    double rate = 0;
+
+    std::map<std::string, std::string>::iterator iter;
+    // Look for init values in map to override init values
+    if ((iter = data_map.find("ipaddr")) != data_map.end())
+        address = iter->second;
+
+    if ((iter = data_map.find("port")) != data_map.end())
+        port = static_cast<uint16_t>(std::stoi(iter->second));
+
+    if ((iter = data_map.find("threads")) != data_map.end())
+        this->threads_count = std::max<size_t>(1, std::stoul(iter->second));
+
+    if ((iter = data_map.find("mode")) != data_map.end()) {
+        if (iter->second == "echo")
+            this->config.mode = R_ECHO;
+        else if (iter->second == "sink")
+            this->config.mode = R_SINK;
+        else
+            throw std::logic_error("Unknown reflector mode provided");
+    }
+
+    if ((iter = data_map.find("rate")) != data_map.end())
+        rate = std::max(0.0, std::stod(iter->second));
+
+    if ((iter = data_map.find("count")) != data_map.end())
+        this->config.blast_count = std::stoul(iter->second);
+
+    if ((iter = data_map.find("size")) != data_map.end())
+        this->config.blast_size = std::min<size_t>(std::stoul(iter->second), 1400);
+
+    this->config.address = {};
+    this->config.address.sin_family = AF_INET;
+    this->config.address.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &this->config.address.sin_addr) != 1)
+        throw std::logic_error("Unknown or invalid address provided");
+
+    // Zero rate means sending as fast as loopback allows
+    if (rate > 0)
+        this->config.send_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+}
+/***********************************************************************************/
+void ReflectorClass::run () {
+    if ((reflector_stop_fd = eventfd(0, EFD_NONBLOCK)) < 0)
+        throw std::logic_error("Event descriptor creation failed");
+
+    // Create all workers first, so failed bind ends the program before serving starts
+    std::vector<ReflectorStats> worker_stats(this->threads_count);
+    std::vector<std::unique_ptr<ReflectorWorkerClass>> workers;
+    for (size_t worker = 0; worker < this->threads_count; ++worker)
+        workers.push_back(std::make_unique<ReflectorWorkerClass>(this->config, worker_stats[worker], reflector_stop_fd));
+
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+
+    char address[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &this->config.address.sin_addr, address, sizeof(address));
+    OutputClass::out_line("Reflector listening on " + std::string(address) + ":" + std::to_string(ntohs(this->config.address.sin_port)) +
+                          " (UDP and TCP), " + std::to_string(this->threads_count) + " threads");
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (auto& worker : workers) {
+            threads.emplace_back([&worker] {
+                try {
+                    worker->run();
+                } catch (const std::logic_error& e) {
+                    OutputClass::out_err_intern(e.what());
+                    // Stop the others too
+                    stop_handler(0);
+                }
+            });
+        }
+    } // Workers are joined when getting out of scope
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    workers.clear();
+    close(reflector_stop_fd);
+
+    ReflectorStats total;
+    for (ReflectorStats& stats : worker_stats) {
+        total.clients           += stats.clients;
+        total.received          += stats.received;
+        total.duplicates        += stats.duplicates;
+        total.malformed         += stats.malformed;
+        total.confirms_received += stats.confirms_received;
+        total.confirms_sent     += stats.confirms_sent;
+        total.replies_sent      += stats.replies_sent;
+        total.msgs_sent         += stats.msgs_sent;
+    }
+    report(total, elapsed);
+}
+/***********************************************************************************/
+void ReflectorClass::report (ReflectorStats& total, double elapsed) {
+    char line[256];
+    snprintf(line, sizeof(line), "reflector: %llu clients, %.3f s", static_cast<unsigned long long>(total.clients), elapsed);
+    OutputClass::out_line(line);
+    snprintf(line, sizeof(line), "received: %llu msgs (%llu duplicates, %llu malformed), %llu CONFIRM",
+             static_cast<unsigned long long>(total.received), static_cast<unsigned long long>(total.duplicates),
+             static_cast<unsigned long long>(total.malformed), static_cast<unsigned long long>(total.confirms_received));
+    OutputClass::out_line(line);
+    snprintf(line, sizeof(line), "sent: %llu REPLY, %llu MSG (%.1f msgs/s), %llu CONFIRM",
+             static_cast<unsigned long long>(total.replies_sent), static_cast<unsigned long long>(total.msgs_sent),
+             (elapsed > 0 ? total.msgs_sent / elapsed : 0.0), static_cast<unsigned long long>(total.confirms_sent));
+    OutputClass::out_line(line);
+}
\ No newline at end of file
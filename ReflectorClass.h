@@ -0,0 +1,159 @@
+#ifndef REFLECTORCLASS_H
+#define REFLECTORCLASS_H
+
+#include "ConstsFile.h"
+#include "FramerClass.h"
+#include "TokenizerClass.h"
+#include "DupFilterClass.h"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <deque>
+#include <memory>
+
+// How reflector answers MSG from client
+enum REFLECT_MODE : uint8_t {
+    R_ECHO = 0, // MSG is sent back to its sender unchanged
+    R_SINK      // MSG is only confirmed (UDP) or dropped (TCP)
+};
+
+// Settings shared by all workers
+typedef struct {
+    struct sockaddr_in address;
+    REFLECT_MODE mode = R_ECHO;
+    // MSGs sent to each client right after its successful AUTH
+    size_t blast_count = 0;
+    size_t blast_size = 64;
+    // Least time between two MSGs sent to one client, zero for no limit
+    std::chrono::steady_clock::duration send_interval = std::chrono::steady_clock::duration::zero();
+} ReflectorConfig;
+
+// Counters of single worker, merged once workers finish
+typedef struct {
+    uint64_t clients           = 0;
+    uint64_t received          = 0;
+    uint64_t duplicates        = 0;
+    uint64_t malformed         = 0;
+    uint64_t confirms_received = 0;
+    uint64_t confirms_sent     = 0;
+    uint64_t replies_sent      = 0;
+    uint64_t msgs_sent         = 0;
+} ReflectorStats;
+
+// MSG waiting for send rate or free space in TCP output
+typedef struct {
+    std::string display_name;
+    std::string content;
+} ReflectorEcho;
+
+// Client as seen by reflector, UDP clients are told apart by address, TCP ones by socket
+typedef struct {
+    int fd = -1; // -1 for UDP client
+    struct sockaddr_in addr = {};
+    // msg_id of next UDP message sent to client
+    uint16_t msg_id = 0;
+    // TCP connection is closed once output is written
+    bool leaving = false;
+    // Listed among peers with MSGs to send
+    bool pending = false;
+    // Waiting for TCP socket to become writable
+    bool want_write = false;
+    std::chrono::steady_clock::time_point next_send = {};
+    std::deque<ReflectorEcho> echoes;
+    size_t blast_left = 0;
+    uint64_t blast_seq = 0;
+    // UDP only, duplicates are confirmed again but not answered
+    DupFilterClass seen;
+    // TCP only
+    std::unique_ptr<FramerClass> framer;
+    std::string out_data;
+    size_t out_pos = 0;
+} ReflectorPeer;
+
+// Single event loop serving its own UDP socket and TCP listener, kernel spreads clients among workers (SO_REUSEPORT)
+class ReflectorWorkerClass {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        const ReflectorConfig& config;
+        ReflectorStats& stats;
+        int stop_fd;
+        int epoll_fd;
+        int timer_fd;
+        int udp_fd;
+        int listen_fd;
+
+        // UDP clients keyed by address and port, TCP clients by socket with TCP_KEY bit set
+        std::unordered_map<uint64_t, ReflectorPeer> peers;
+        // Keys of peers having MSGs to send, may contain peers already gone
+        std::vector<uint64_t> pending;
+
+        // UDP datagrams received by single recvmmsg
+        std::vector<char> in_buffers;
+        std::vector<struct sockaddr_in> in_addrs;
+        std::vector<struct iovec> in_iovs;
+        std::vector<struct mmsghdr> in_msgs;
+        // UDP datagrams composed during one loop iteration, sent by single sendmmsg
+        std::vector<char> out_buffers;
+        std::vector<struct sockaddr_in> out_addrs;
+        std::vector<struct iovec> out_iovs;
+        std::vector<struct mmsghdr> out_msgs;
+        size_t out_count;
+
+        int open_socket (int type);
+        void receive_udp ();
+        void accept_tcp ();
+        void receive_tcp (uint64_t key, ReflectorPeer& peer);
+        void handle_udp (uint64_t key, std::string_view datagram, const struct sockaddr_in& addr);
+        // Returns false once client was closed
+        bool handle_tcp (uint64_t key, ReflectorPeer& peer, std::string_view frame);
+        void handle_msg (uint64_t key, ReflectorPeer& peer, std::string_view display_name, std::string_view content);
+        void start_session (uint64_t key, ReflectorPeer& peer);
+        void schedule (uint64_t key, ReflectorPeer& peer);
+        clock::time_point serve (ReflectorPeer& peer, clock::time_point now);
+        bool rate_allows (ReflectorPeer& peer, clock::time_point now);
+
+        void send_confirm (ReflectorPeer& peer, uint16_t ref_msg_id);
+        void send_reply (ReflectorPeer& peer, uint16_t ref_msg_id, std::string_view content);
+        void send_msg (ReflectorPeer& peer, std::string_view display_name, std::string_view content);
+        void send_blast (ReflectorPeer& peer);
+        void send_err (ReflectorPeer& peer, std::string_view content);
+        void send_bye (ReflectorPeer& peer);
+        // Starts next datagram of the batch with header, udp_commit adds it once it is composed
+        char* udp_slot (ReflectorPeer& peer, uint8_t type, size_t& out_size);
+        void udp_commit (size_t out_size);
+        void flush_udp ();
+        // Appends "\r\n" terminated line composed of given parts to client output
+        void put_text (ReflectorPeer& peer, std::initializer_list<std::string_view> parts);
+        // Writes as much of client output as socket takes, false if some is left
+        bool flush_tcp (ReflectorPeer& peer);
+        void close_peer (uint64_t key);
+
+        static void put_msg_id (char* output, size_t& output_pos, uint16_t msg_id);
+        static void put_msg_part (char* output, size_t& output_pos, std::string_view part);
+
+    public:
+        ReflectorWorkerClass (const ReflectorConfig& config, ReflectorStats& stats, int stop_fd);
+        ~ReflectorWorkerClass ();
+        // Binds sockets and serves clients till stop_fd becomes readable
+        void run ();
+};
+
+// Loopback reflector server for benchmarks, answers both UDP and TCP variant of the protocol on one port
+class ReflectorClass {
+    private:
+        ReflectorConfig config;
+        size_t threads_count;
+
+        void report (ReflectorStats& total, double elapsed);
+
+    public:
+        ReflectorClass (std::map<std::string, std::string> data_map);
+        // Serves clients till SIGINT/SIGTERM and outputs counters
+        void run ();
+};
+
+#endif // REFLECTORCLASS_H
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef SENDQUEUECLASS_H
+#define SENDQUEUECLASS_H
+
+#include "MPSCQueueClass.h"
+
+// Messages waiting to be sent to server. Any thread may queue a message without locking,
+// session ending messages (BYE/ERR) go through separate priority lane and jump ahead of everything
+// queued in the normal one. Taking messages out is done by single consumer at a time
+template <typename T>
+class SendQueueClass {
+    public:
+        static constexpr uint32_t NORMAL_SLOTS   = 1024;
+        // Only few session ending messages are ever sent
+        static constexpr uint32_t PRIORITY_SLOTS = 16;
+        // Number of messages both lanes can hold together
+        static constexpr uint32_t CAPACITY       = NORMAL_SLOTS + PRIORITY_SLOTS;
+
+        SendQueueClass ()
+        : front_priority (false)
+        {
+        }
+
+        void push (T&& item) {
+            this->normal.push(std::move(item));
+        }
+        void push_priority (T&& item) {
+            this->priority.push(std::move(item));
+        }
+        // Returns next message to send, priority lane first, nullptr if there is none
+        T* front () {
+            T* item = this->priority.front();
+            this->front_priority = (item != nullptr);
+            return (item != nullptr) ? item : this->normal.front();
+        }
+        // Removes message returned by last front(), even if priority message was queued since
+        void pop () {
+            if (this->front_priority == true)
+                this->priority.pop();
+            else
+                this->normal.pop();
+        }
+        // Returns true if message returned by last front() came through priority lane
+        bool is_priority () {
+            return this->front_priority;
+        }
+        bool empty () {
+            return front() == nullptr;
+        }
+        // Number of messages waiting in both lanes
+        uint32_t size () {
+            return this->priority.size() + this->normal.size();
+        }
+
+    private:
+        MPSCQueueClass<T, NORMAL_SLOTS> normal;
+        MPSCQueueClass<T, PRIORITY_SLOTS> priority;
+        bool front_priority;
+};
+
+#endif // SENDQUEUECLASS_H
\ No newline at end of file
@@ -0,0 +1,165 @@
+#ifndef SESSIONTASKCLASS_H
+#define SESSIONTASKCLASS_H
+
+#include <coroutine>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Frames of finished coroutines kept by each thread for the next ones of the same size, so coroutine started
+// for every sent message doesnt allocate once few of them ran. Blocks are linked through their own memory
+class FramePoolClass {
+    public:
+        static void* acquire (size_t size) {
+            Bucket* bucket = find(size);
+            if (bucket == nullptr || bucket->head == nullptr)
+                return ::operator new(size);
+            FreeFrame* frame = bucket->head;
+            bucket->head = frame->next;
+            return frame;
+        }
+        static void release (void* memory, size_t size) {
+            Bucket* bucket = find(size);
+            if (bucket == nullptr) {
+                ::operator delete(memory);
+                return;
+            }
+            bucket->head = new (memory) FreeFrame{bucket->head};
+        }
+
+    private:
+        // Only few coroutine functions exist, each has its own frame size
+        static constexpr size_t BUCKETS = 8;
+
+        struct FreeFrame {
+            FreeFrame* next;
+        };
+        struct Bucket {
+            size_t size = 0;
+            FreeFrame* head = nullptr;
+        };
+        struct Pool {
+            Bucket buckets[BUCKETS];
+            ~Pool () {
+                for (Bucket& bucket : this->buckets)
+                    while (bucket.head != nullptr)
+                        ::operator delete(std::exchange(bucket.head, bucket.head->next));
+            }
+        };
+
+        // Bucket of given frame size, new one is claimed for unknown size. Nullptr once all are taken
+        static Bucket* find (size_t size) {
+            thread_local Pool pool;
+            for (Bucket& bucket : pool.buckets) {
+                if (bucket.size == size)
+                    return &bucket;
+                if (bucket.size == 0) {
+                    bucket.size = size;
+                    return &bucket;
+                }
+            }
+            return nullptr;
+        }
+};
+
+// Coroutine running script of single session. It starts suspended and only its owner resumes it, always from
+// the same thread, so suspension points need no locking. Frame is destroyed together with the task.
+// Another coroutine may await the task instead - that starts it and goes on once the task finished
+class SessionTaskClass {
+    public:
+        struct promise_type {
+            // Coroutine awaiting this one, resumed at its end
+            std::coroutine_handle<> continuation;
+
+            static void* operator new (size_t size) {
+                return FramePoolClass::acquire(size);
+            }
+            static void operator delete (void* memory, size_t size) {
+                FramePoolClass::release(memory, size);
+            }
+            SessionTaskClass get_return_object () {
+                return SessionTaskClass(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend () noexcept {
+                return {};
+            }
+            // Finished script stays suspended at its end, so owner can tell it is done
+            auto final_suspend () noexcept {
+                struct FinalAwaiter {
+                    bool await_ready () noexcept {
+                        return false;
+                    }
+                    std::coroutine_handle<> await_suspend (std::coroutine_handle<promise_type> finished) noexcept {
+                        std::coroutine_handle<> continuation = finished.promise().continuation;
+                        return (continuation != nullptr) ? continuation : std::noop_coroutine();
+                    }
+                    void await_resume () noexcept {
+                    }
+                };
+                return FinalAwaiter{};
+            }
+            void return_void () {
+            }
+            // Exception leaves through resume() of the owner
+            void unhandled_exception () {
+                throw;
+            }
+        };
+
+        SessionTaskClass ()
+        : handle (nullptr)
+        {
+        }
+        SessionTaskClass (SessionTaskClass&& other) noexcept
+        : handle (std::exchange(other.handle, nullptr))
+        {
+        }
+        SessionTaskClass& operator= (SessionTaskClass&& other) noexcept {
+            if (this != &other) {
+                if (this->handle != nullptr)
+                    this->handle.destroy();
+                this->handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+        ~SessionTaskClass () {
+            if (this->handle != nullptr)
+                this->handle.destroy();
+        }
+
+        // Runs script till its next suspension point
+        void resume () {
+            this->handle.resume();
+        }
+        // Returns true once script reached its end
+        bool done () {
+            return this->handle == nullptr || this->handle.done();
+        }
+        // Awaiting coroutine is suspended till the task finishes, task runs right away on the same thread
+        auto operator co_await () noexcept {
+            struct TaskAwaiter {
+                std::coroutine_handle<promise_type> task;
+
+                bool await_ready () noexcept {
+                    return this->task.done();
+                }
+                std::coroutine_handle<> await_suspend (std::coroutine_handle<> awaiting) noexcept {
+                    this->task.promise().continuation = awaiting;
+                    return this->task;
+                }
+                void await_resume () noexcept {
+                }
+            };
+            return TaskAwaiter{this->handle};
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        explicit SessionTaskClass (std::coroutine_handle<promise_type> handle)
+        : handle (handle)
+        {
+        }
+};
+
+#endif // SESSIONTASKCLASS_H
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "TCPClass.h"
 
 TCPClass::TCPClass(std::map<std::string, std::string> data_map)
-    : ClientClass ()
+    : ClientClass    (),
+      msg_id         (0),
+      received_count (0)
 {
     std::map<std::string, std::string>::iterator iter;
     // Look for init values in map to override init values
@@ -10,6 +12,11 @@ TCPClass::TCPClass(std::map<std::string, std::string> data_map)
 
     if ((iter = data_map.find("port")) != data_map.end())
         this->port = static_cast<uint16_t>(std::stoi(iter->second));
+
+    if ((iter = data_map.find("engine")) != data_map.end()) {
+        this->use_threads = (iter->second != std::string("epoll"));
+        this->use_uring = (iter->second == std::string("uring"));
+    }
 }
 /***********************************************************************************/
 void TCPClass::open_connection() {
@@ -36,14 +43,33 @@ void TCPClass::open_connection() {
     if (connect(this->socket_id, (struct sockaddr *)&server_addr, sizeof(server_addr)) != 0)
         throw std::logic_error("Error connecting to TCP server");
 
+    // Every message is either queued or just being sent
+    this->pool.init(SendQueueClass<MessageClass*>::CAPACITY + 8);
+
+    // Event loop engine drives the client by itself, session runs as coroutines
+    if (this->use_threads == false) {
+        start_session(1);
+        return;
+    }
+
+    // Wakes user input thread at session end, receive thread is woken by socket shutdown
+    open_stop_event();
+
     // Create threads for sending and receiving server msgs
     this->send_thread = std::jthread(&TCPClass::handle_send, this);
     this->recv_thread = std::jthread(&TCPClass::handle_receive, this);
 }
 /***********************************************************************************/
 void TCPClass::session_end() {
-    this->stop_send = true;
-    this->stop_recv = true;
+    {
+        std::lock_guard<std::mutex> lock(this->editing_front_mutex);
+        this->stop_send = true;
+        this->stop_recv = true;
+    }
+    // Notify send thread
+    this->send_cond_var.notify_one();
+    // Wake user input thread
+    signal_stop();
     // Change state
     this->cur_state = S_END;
     // Clear sockets
@@ -54,46 +80,39 @@ void TCPClass::session_end() {
     close(this->socket_id);
     // Exit the program by notifying main function
     this->end_program = true;
-    this->cond_var.notify_one();
+    notify_main();
     // Ensure stopping of user input handling thread
-    this->load_input = true;
-    this->input_cond_var.notify_one();
+    allow_user_input();
 }
 /***********************************************************************************/
-void TCPClass::send_auth(std::string user, std::string display, std::string secret) {
+bool TCPClass::send_auth(std::string_view user, std::string_view display, std::string_view secret) {
     // Update display name
-    if (send_rename(display) == false)
-        return;
+    if (send_rename(std::string(display)) == false)
+        return false;
 
-    TCP_DataStruct data = {
-        .type = AUTH,
-        .user_name = user,
-        .display_name = display,
-        .secret = secret
-    };
-    send_message(data);
+    MessageClass* data = this->pool.acquire(AUTH);
+    data->set(P_USER_NAME, user);
+    data->set(P_DISPLAY_NAME, display);
+    data->set(P_SECRET, secret);
+    return send_message(data);
 }
 
-void TCPClass::send_msg(std::string msg) {
-    TCP_DataStruct data = {
-        .type = MSG,
-        .message = msg,
-        .display_name = this->display_name
-    };
-    send_message(data);
+bool TCPClass::send_msg(std::string_view msg) {
+    MessageClass* data = this->pool.acquire(MSG);
+    data->set(P_DISPLAY_NAME, this->display_name);
+    data->set(P_MESSAGE, msg);
+    return send_message(data);
 }
 
-void TCPClass::send_join(std::string channel_id) {
-    TCP_DataStruct data = {
-        .type = JOIN,
-        .display_name = this->display_name,
-        .channel_id = channel_id
-    };
-    send_message(data);
+bool TCPClass::send_join(std::string_view channel_id) {
+    MessageClass* data = this->pool.acquire(JOIN);
+    data->set(P_CHANNEL_ID, channel_id);
+    data->set(P_DISPLAY_NAME, this->display_name);
+    return send_message(data);
 }
 
 bool TCPClass::send_rename(std::string new_display_name) {
-    if (regex_match(new_display_name, display_name_pattern) == false) {
+    if (ValidatorClass::display_name(new_display_name) == false) {
         OutputClass::out_err_intern("Invalid new value for display name");
         return false;
     }
@@ -104,287 +123,404 @@ bool TCPClass::send_rename(std::string new_display_name) {
 
 void TCPClass::send_bye() {
     // Send bye message
-    TCP_DataStruct data = {
-        .type = BYE
-    };
-    send_message(data);
+    send_message(this->pool.acquire(BYE));
 }
 /***********************************************************************************/
 void TCPClass::send_priority_bye () {
-    this->high_priority = true;
     // Switch to end state
     this->cur_state = S_END;
-    send_bye();
+
+    send_message(this->pool.acquire(BYE), true);
 }
 /***********************************************************************************/
 void TCPClass::send_err (std::string err_msg) {
     // Switch to err state
     this->cur_state = S_ERROR;
 
-    TCP_DataStruct data = {
-        .type = ERR,
-        .message = err_msg,
-        .display_name = this->display_name
-    };
-    send_message(data);
+    MessageClass* data = this->pool.acquire(ERR);
+    data->set(P_DISPLAY_NAME, this->display_name);
+    data->set(P_MESSAGE, err_msg);
+    send_message(data, true);
 }
 /***********************************************************************************/
-void TCPClass::send_message(TCP_DataStruct &data) {
+bool TCPClass::send_message(MessageClass* data, bool priority) {
     // Check for message validity
-    if (check_valid_msg<TCP_DataStruct>(data.type, data) == false) {
+    if (check_valid_msg(*data) == false) {
+        this->pool.release(data);
         OutputClass::out_err_intern("Invalid content of message provided, wont send");
-        return;
-    }
-
-    // Avoid racing between main and response thread
-    std::lock_guard<std::mutex> lock(this->editing_front_mutex);
-    if (this->high_priority == true) {
-        // Clear the queue
-        this->messages_to_send = {};
-        // Reset waiting for reply flag
-        this->wait_for_reply = false;
-        // Reset priority flag after using
-        this->high_priority = false;
+        return false;
     }
-    // Add new message to the queue with given resend count
-    this->messages_to_send.push(data);
+    data->msg_id = this->msg_id++;
+    TraceClass::record(T_ENQUEUE, data->msg_id, data->type);
+
+    // Add new message to the queue, queue is safe to use from any thread without locking
+    if (priority == true)
+        this->messages_to_send.push_priority(std::move(data));
+    else
+        this->messages_to_send.push(std::move(data));
+    // Wake up sending thread
+    notify_sender();
+    return true;
 }
 /***********************************************************************************/
-void TCPClass::send_data(TCP_DataStruct &data) {
+void TCPClass::send_data(MessageClass &data) {
     // Prepare data to send
-    std::string message = convert_to_string(data);
-    const char* out_buffer = message.c_str();
+    char out_buffer[MAXLENGTH];
+    size_t out_size = serialize_msg(data, out_buffer);
 
     // Send data
-    ssize_t bytes_send = send(this->socket_id, out_buffer, message.size(), 0);
+    ssize_t bytes_send = send(this->socket_id, out_buffer, out_size, 0);
+    MetricsClass::count(C_SEND_SYSCALLS);
 
     // Check for errors
     if (bytes_send < 0)
         OutputClass::out_err_intern("Error while sending data to server");
+    else {
+        MetricsClass::count(C_MSGS_SENT);
+        TraceClass::record(T_SEND, data.msg_id, data.type);
+    }
 }
 /***********************************************************************************/
-MSG_TYPE TCPClass::get_msg_type(std::string first_msg_word) {
-    if (std::regex_match(first_msg_word, std::regex("^REPLY$", std::regex_constants::icase)))
-        return REPLY;
-    if (std::regex_match(first_msg_word, std::regex("^AUTH$", std::regex_constants::icase)))
-        return AUTH;
-    if (std::regex_match(first_msg_word, std::regex("^JOIN$", std::regex_constants::icase)))
-        return JOIN;
-    if (std::regex_match(first_msg_word, std::regex("^MSG$", std::regex_constants::icase)))
-        return MSG;
-    if (std::regex_match(first_msg_word, std::regex("^ERR$", std::regex_constants::icase)))
-        return ERR;
-    if (std::regex_match(first_msg_word, std::regex("^BYE$", std::regex_constants::icase)))
-        return BYE;
-    return NO_TYPE;
+void TCPClass::queue_data (MessageClass& data) {
+    // Ring is full, send what is queued first
+    if (this->uring_sent.size() == URING_ENTRIES)
+        flush_queued();
+
+    // Linked sends keep order of messages in stream, each one has its own buffer till it is sent
+    char* out_buffer = this->uring_out.data() + this->uring_sent.size() * MAXLENGTH;
+    size_t out_size = serialize_msg(data, out_buffer);
+    this->send_ring.prepare_send(this->socket_id, out_buffer, out_size, UringClass::tag(URING_SEND, this->uring_sent.size()), true);
+    this->uring_sent.push_back({data.msg_id, data.type});
+}
+/***********************************************************************************/
+void TCPClass::flush_queued () {
+    if (this->uring_sent.empty() == true)
+        return;
+
+    // Submit all queued messages and wait till they are sent with single syscall
+    MetricsClass::count(C_SEND_SYSCALLS);
+    if (this->send_ring.submit(this->uring_sent.size()) < 0) {
+        OutputClass::out_err_intern("Error while sending data to server");
+        this->uring_sent.clear();
+        return;
+    }
+    this->send_ring.take_completions(this->send_completions);
+    for (const UringCompletion& completion : this->send_completions) {
+        if (completion.result < 0) {
+            OutputClass::out_err_intern("Error while sending data to server");
+            continue;
+        }
+        const UringSent& sent = this->uring_sent[UringClass::slot(completion.user_data)];
+        MetricsClass::count(C_MSGS_SENT);
+        TraceClass::record(T_SEND, sent.msg_id, sent.type);
+    }
+    this->uring_sent.clear();
 }
 /***********************************************************************************/
 void TCPClass::handle_send() {
+    TraceClass::set_thread_name("send");
+    // Without io_uring each message is sent by its own syscall
+    if (this->use_uring == true && this->send_ring.init() == true)
+        this->uring_out.resize(URING_ENTRIES * MAXLENGTH);
     while (this->stop_send == false) {
-        { // Mutex lock scope
+        {
+            // Sleep till there is something to send
             std::unique_lock<std::mutex> lock(this->editing_front_mutex);
-            if (this->messages_to_send.empty() == true && this->wait_for_reply == false) {
-                this->load_input = true;
-                this->input_cond_var.notify_one();
+            wait_sender(lock, [&] {
+                return (can_send_next() || this->stop_send);
+            });
+        }
+        send_queued();
+    }
+}
+/***********************************************************************************/
+bool TCPClass::can_send_next () {
+    // Nothing to send
+    if (this->messages_to_send.front() == nullptr)
+        return false;
+    // First session ending message doesnt wait for server reply
+    if (this->messages_to_send.is_priority() == true && this->priority_taken == false)
+        return true;
+    // Blocked to send anything atm (waiting for server reply)
+    return (this->wait_for_reply == false);
+}
+/***********************************************************************************/
+void TCPClass::send_pending () {
+    run_session();
+}
+/***********************************************************************************/
+SessionTaskClass TCPClass::deliver (MessageClass* to_send) {
+    // Server closes connection after BYE, dont report it as unexpected
+    if (to_send->type == BYE)
+        this->stop_recv = true;
+    // Written to the stream means delivered, nothing is kept after that
+    send_data(*to_send);
+    this->pool.release(to_send);
+    co_return;
+}
+/***********************************************************************************/
+void TCPClass::send_queued () {
+    bool bye_sent = false;
+    { // Mutex lock scope
+        std::unique_lock<std::mutex> lock(this->editing_front_mutex);
+        while (this->stop_send == false && can_send_next() == true) {
+            // Load message to send from queue front
+            MessageClass* to_send = *this->messages_to_send.front();
+            MetricsClass::record(H_QUEUE_DEPTH, this->messages_to_send.size());
+            if (this->messages_to_send.is_priority() == true && this->priority_taken == false)
+                abandon_sent();
+            // Remove message from queue as it is going to be sent
+            this->messages_to_send.pop();
+
+            // Check if given message can be send in client's current state
+            if (check_msg_context(to_send->type, this->cur_state) == false) {
+                OutputClass::out_err_intern("Sending this type of message is prohibited for current client state");
+                this->pool.release(to_send);
+                continue;
             }
-            else if (this->messages_to_send.empty() == false && this->wait_for_reply == false) {
-                // Stop sending if requested
-                if (this->stop_send == true)
-                    break;
-
-                // Load message to send from queue front
-                auto to_send = this->messages_to_send.front();
 
-                // Check if given message can be send in client's current state
-                if (check_msg_context(to_send.type, this->cur_state) == false) {
-                    OutputClass::out_err_intern("Sending this type of message is prohibited for current client state");
-                    // Remove this message from queue
-                    this->messages_to_send.pop();
-                    continue;
-                }
-
-                // Send it to server
-                send_data(to_send);
-
-                // Wait with sending another msgs till REPLY from server is received
-                if (to_send.type == AUTH || to_send.type == JOIN)
-                    this->wait_for_reply = true;
-
-                // After sending BYE to server, close connection
-                if (to_send.type == BYE)
-                    session_end();
-
-                // Remove message after being sent
-                this->messages_to_send.pop();
+            // Wait with sending another msgs till REPLY from server is received,
+            // set before sending as REPLY may be received before send_data returns
+            uint8_t sent_type = to_send->type;
+            if (sent_type == AUTH || sent_type == JOIN) {
+                this->request_start = std::chrono::steady_clock::now();
+                this->request_id = to_send->msg_id;
+                this->wait_for_reply = true;
             }
-        } // Mutex unlocks when getting out of scope
+            // Server closes connection after BYE, dont report it as unexpected
+            if (sent_type == BYE)
+                this->stop_recv = true;
+
+            // Send it to server, nothing is kept after that
+            if (this->send_ring.active() == true)
+                queue_data(*to_send);
+            else
+                send_data(*to_send);
+            this->pool.release(to_send);
+
+            // After sending BYE to server, close connection
+            if (sent_type == BYE) {
+                bye_sent = true;
+                break;
+            }
+        }
+        // Messages queued in ring are sent before session can end
+        flush_queued();
+        // Everything sent, allow next user input
+        if (this->messages_to_send.empty() == true && this->wait_for_reply == false)
+            allow_user_input();
+    } // Mutex unlocks when getting out of scope
+
+    if (bye_sent == true)
+        session_end();
+}
+/***********************************************************************************/
+void TCPClass::abandon_sent () {
+    // Session is ending, dont wait for reply to anything sent before
+    this->wait_for_reply = false;
+    this->priority_taken = true;
+}
+/***********************************************************************************/
+bool TCPClass::reply_expected (uint16_t ref_msg_id) {
+    // REPLY always refers to the last request, its ref_msg_id is filled in by the client
+    (void)ref_msg_id;
+    return true;
+}
+/***********************************************************************************/
+void TCPClass::reply_finished () {
+    {
+        std::lock_guard<std::mutex> lock(this->editing_front_mutex);
+        if (this->wait_for_reply == true)
+            MetricsClass::record_since(H_REPLY_WAIT, this->request_start);
+        this->wait_for_reply = false;
+        // Nothing else to send, allow next user input
+        if (this->messages_to_send.empty() == true)
+            allow_user_input();
     }
+    // Notify send thread
+    this->send_cond_var.notify_one();
 }
 /***********************************************************************************/
 void TCPClass::switch_to_error (std::string err_msg) {
     // Notify user
     OutputClass::out_err_intern(err_msg);
-    // Clear the queue
-    this->high_priority = true;
-    // Notify server
+    // Notify server, ERR jumps ahead of all queued messages
     send_err(err_msg);
-    // Then send BYE and end
-    send_bye();
+    // Then send BYE right after it and end
+    send_message(this->pool.acquire(BYE), true);
 }
 /***********************************************************************************/
 void TCPClass::handle_receive () {
-    char in_buffer[MAXLENGTH];
-    size_t msg_shift = 0;
-    std::string response;
+    TraceClass::set_thread_name("receive");
+    // Plain syscalls are used when io_uring isnt available
+    if (this->use_uring == true && uring_receive() == true)
+        return;
+    while (this->stop_recv == false)
+        receive_chunk(0);
+}
+/***********************************************************************************/
+void TCPClass::receive_pending () {
+    // Take all already waiting data
+    while (this->stop_recv == false && receive_chunk(MSG_DONTWAIT) == true);
+}
+/***********************************************************************************/
+bool TCPClass::receive_chunk (int flags) {
+    // Whole buffer is filled with single incomplete message
+    if (this->framer.write_space() == 0) {
+        this->framer.clear();
+        switch_to_error("Too long message received");
+        return true;
+    }
 
-    while (this->stop_recv == false) {
-        ssize_t bytes_received =
-            recv(this->socket_id, (in_buffer + msg_shift), (MAXLENGTH - msg_shift), 0);
+    ssize_t bytes_received =
+        recv(this->socket_id, this->framer.write_ptr(), this->framer.write_space(), flags);
+    MetricsClass::count(C_RECV_SYSCALLS);
 
-        if (this->stop_recv == true) // Stop when requested
-            break;
+    if (this->stop_recv == true) // Stop when requested
+        return false;
 
-        if (bytes_received <= 0) {
-            OutputClass::out_err_intern("Unexpected server disconnected");
-            session_end();
+    // Nothing waiting on non-blocking socket
+    if (bytes_received < 0 && (errno == EWOULDBLOCK || errno == EAGAIN) && (flags & MSG_DONTWAIT))
+        return false;
+
+    if (bytes_received <= 0) {
+        OutputClass::out_err_intern("Unexpected server disconnected");
+        session_end();
+        return false;
+    }
+    this->framer.commit(bytes_received);
+    process_frames();
+    return true;
+}
+/***********************************************************************************/
+void TCPClass::process_frames () {
+    // Iterate through all completed messages, incomplete one stays in framer till rest of it arrives
+    std::string_view cur_msg;
+    while (this->framer.next_frame(cur_msg) == true) {
+        MetricsClass::count(C_MSGS_RECEIVED);
+        MessageClass data;
+        data.msg_id = this->received_count++;
+        TraceClass::record(T_RECEIVE, data.msg_id);
+        try { // Check for valid msg_type provided
+            deserialize_msg(cur_msg, data);
+        } catch (const std::logic_error& e) {
+            // Invalid message from server -> end connection
+            this->framer.clear();
+            switch_to_error(e.what());
             break;
         }
+        TraceClass::record(T_DESERIALIZE, data.msg_id, data.type);
 
-        // Store response to string
-        std::string recv_data((in_buffer + msg_shift), bytes_received);
-        response += recv_data;
+        // REPLY carries no ref_msg_id on the wire, it answers the last request
+        if (data.type == REPLY)
+            data.ref_msg_id = this->request_id;
+        // Process response
+        handle_server_msg(data);
+    }
+}
+/***********************************************************************************/
+bool TCPClass::uring_receive () {
+    if (this->recv_ring.init() == false || this->recv_ring.init_buffers(0, TCP_URING_BUFFERS, TCP_URING_BUFFER_SIZE) == false)
+        return false;
+    // Socket shutdown at session end completes the receive, no stop event is needed
+    this->recv_ring.prepare_recv(this->socket_id, UringClass::tag(URING_RECV));
 
-        // Check if message is completed, thus. ending with "\r\n", else continue and wait for rest of message
-        if (std::regex_search(recv_data, std::regex("\\r\\n$")) == false) {
-            msg_shift += bytes_received;
-            continue;
+    bool received = false;
+    bool rearm = false;
+    while (this->stop_recv == false) {
+        // Multishot receive ended (no free buffer was left), start it again now that buffers were given back
+        if (rearm == true) {
+            this->recv_ring.prepare_recv(this->socket_id, UringClass::tag(URING_RECV));
+            rearm = false;
         }
-        // Reuse it
-        size_t end_symb_pos = 0;
-        // When given buffer contains multiple messages, iterate thorugh them
-        while ((end_symb_pos = response.find("\r\n")) != std::string::npos) {
-            std::string cur_msg = response.substr(0, end_symb_pos);
-
-            // Move in buffer to another msg (if any)
-            response.erase(0, (end_symb_pos + /*delimiter length*/2));
-
-            // Load whole message - each msg ends with "\r\n";
-            split_to_vec(cur_msg, this->line_vec, ' ');
-
-            TCP_DataStruct data;
-            try { // Check for valid msg_type provided
-                deserialize_msg(data);
-            } catch (const std::logic_error& e) {
-                // Invalid message from server -> end connection
-                switch_to_error(e.what());
-                break;
+        // Sleep till data arrives, prepared operations are submitted by the same syscall
+        MetricsClass::count(C_RECV_SYSCALLS);
+        if (this->recv_ring.submit(1) < 0) {
+            OutputClass::out_err_intern("Error while waiting for data from server");
+            return true;
+        }
+        this->recv_ring.take_completions(this->recv_completions);
+        bool provided = true;
+        for (const UringCompletion& completion : this->recv_completions) {
+            if (UringClass::kind(completion.user_data) == URING_PROVIDE) {
+                OutputClass::out_err_intern("Error while giving receive buffers back to kernel");
+                continue;
             }
-
-            // Process response
-            switch (this->cur_state) {
-                case S_AUTH:
-                    switch (data.type) {
-                        case REPLY:
-                            // Output message
-                            OutputClass::out_reply(data.result, data.message);
-
-                            if (data.result == true) // Positive reply - switch to open
-                                this->cur_state = S_OPEN;
-                            // else: Negative reply -> stay in AUTH state and allow user to re-authenticate
-
-                            // Reset waiting for reply flag
-                            this->wait_for_reply = false;
-                            break;
-                        case ERR: // Output error and end
-                            OutputClass::out_err_server(data.display_name, data.message);
-                            send_priority_bye();
-                            break;
-                        default: // Transition to error state
-                            switch_to_error("Unexpected message received");
-                            break;
-                    }
-                    break;
-                case S_OPEN:
-                    switch (data.type) {
-                        case REPLY:
-                            // Output server reply
-                            OutputClass::out_reply(data.result, data.message);
-                            // Reset waiting for reply flag
-                            this->wait_for_reply = false;
-                            break;
-                        case MSG: // Output message
-                            OutputClass::out_msg(data.display_name, data.message);
-                            break;
-                        case ERR: // Output error and send bye
-                            OutputClass::out_err_server(data.display_name, data.message);
-                            send_priority_bye();
-                            break;
-                        case BYE: // End connection
-                            session_end();
-                            break;
-                        default: // Transition to error state
-                            switch_to_error("Unexpected message received");
-                            break;
-                    }
-                    break;
-                case S_ERROR: // Switch to end state
-                    this->cur_state = S_END;
-                    send_priority_bye();
-                    break;
-                case S_START: // After initial connection immediate server msg, unexpected
-                    // Notify user
-                    OutputClass::out_err_intern("Unexpected message received");
-                    // Clear the queue
-                    this->high_priority = true;
-                    // Then send BYE and end
-                    send_bye();
-                    break;
-                case S_END: // Ignore everything
-                    break;
-                default: // Not expected state, output error
-                    OutputClass::out_err_intern("Unknown current client state");
+            if ((completion.flags & IORING_CQE_F_MORE) == 0)
+                rearm = true;
+            if (completion.result == -ENOBUFS)
+                continue;
+            // Kernel without multishot receive, plain syscalls take over
+            if (received == false && (completion.result == -EINVAL || completion.result == -EOPNOTSUPP))
+                return false;
+            if (this->stop_recv == true) // Stop when requested
+                return true;
+            if (completion.result <= 0) {
+                OutputClass::out_err_intern("Unexpected server disconnected");
+                session_end();
+                return true;
+            }
+            received = true;
+
+            // Chunk is copied to framer in parts fitting its free space, so frames stay contiguous
+            const char* chunk = this->recv_ring.buffer(completion.flags);
+            size_t chunk_size = completion.result;
+            while (chunk_size > 0 && this->stop_recv == false) {
+                // Whole framer is filled with single incomplete message
+                if (this->framer.write_space() == 0) {
+                    this->framer.clear();
+                    switch_to_error("Too long message received");
                     break;
+                }
+                size_t part_size = std::min(chunk_size, this->framer.write_space());
+                std::memcpy(this->framer.write_ptr(), chunk, part_size);
+                this->framer.commit(part_size);
+                chunk += part_size;
+                chunk_size -= part_size;
+                process_frames();
             }
+            provided = this->recv_ring.add_buffer(UringClass::buffer_id(completion.flags)) && provided;
         }
-        // Reset before next iteration
-        response = "";
-        msg_shift = 0;
-    }
-}
-/***********************************************************************************/
-std::string TCPClass::load_rest (size_t start_from) {
-    std::string out = "";
-    // Concatenate the rest of words as message content
-    for (size_t start_ind = start_from; start_ind < this->line_vec.size(); ++start_ind) {
-        if (start_ind != start_from)
-            out += " ";
-        out += this->line_vec.at(start_ind);
+        if (this->recv_ring.publish_buffers() == false || provided == false)
+            OutputClass::out_err_intern("Error while giving receive buffers back to kernel");
     }
-    return out;
+    return true;
 }
 /***********************************************************************************/
-void TCPClass::deserialize_msg(TCP_DataStruct& out_str) {
-    out_str.type = get_msg_type(this->line_vec.at(0));
+void TCPClass::deserialize_msg(std::string_view frame, MessageClass& out_str) {
+    // Split off message type first, it decides how many fields the rest consists of
+    std::string_view fields[5];
+    size_t fields_count = TokenizerClass::split(frame, fields, 2, ' ');
+    // Message content may contain spaces, so it stays whole in the last field
+    auto split_rest = [&](size_t max_fields) {
+        if (fields_count == 2)
+            fields_count = 1 + TokenizerClass::split(fields[1], fields + 1, max_fields - 1, ' ');
+    };
+
+    out_str.type = TokenizerClass::msg_type(fields[0]);
     switch (out_str.type) {
         case REPLY: // REPLY OK/NOK IS {MessageContent}\r\n
-            if (this->line_vec.size() < 3)
+            split_rest(4);
+            if (fields_count < 3)
                 throw std::logic_error("Unsufficient lenght of REPLY message received");
-            out_str.result = (std::regex_match(this->line_vec.at(1), std::regex("^OK$", std::regex_constants::icase)) ? true : false);
-            out_str.message = load_rest(3);
+            out_str.result = TokenizerClass::is_keyword(fields[1], "OK");
+            out_str.set(P_MESSAGE, (fields_count > 3 ? fields[3] : ""));
             break;
         case MSG: // MSG FROM {DisplayName} IS {MessageContent}\r\n
-            if (this->line_vec.size() < 4)
+            split_rest(5);
+            if (fields_count < 4)
                 throw std::logic_error("Unsufficient lenght of MSG message received");
 
-            out_str.display_name = this->line_vec.at(2);
-            out_str.message = load_rest(4);
+            out_str.set(P_DISPLAY_NAME, fields[2]);
+            out_str.set(P_MESSAGE, (fields_count > 4 ? fields[4] : ""));
             break;
         case ERR: // ERROR FROM {DisplayName} IS {MessageContent}\r\n
-            if (this->line_vec.size() < 4)
+            split_rest(5);
+            if (fields_count < 4)
                 throw std::logic_error("Unsufficient lenght of ERR message received");
 
-            out_str.display_name = this->line_vec.at(2);
-            out_str.message = load_rest(4);
+            out_str.set(P_DISPLAY_NAME, fields[2]);
+            out_str.set(P_MESSAGE, (fields_count > 4 ? fields[4] : ""));
             break;
         case BYE: // BYE\r\n
             break;
@@ -394,31 +530,52 @@ void TCPClass::deserialize_msg(TCP_DataStruct& out_str) {
             throw std::logic_error("Unknown message type provided");
     }
     // Check for msg integrity
-    if (check_valid_msg<TCP_DataStruct>(out_str.type, out_str) == false)
+    if (check_valid_msg(out_str) == false)
         throw std::logic_error("Invalid message provided");
 }
 /***********************************************************************************/
-std::string TCPClass::convert_to_string(TCP_DataStruct &data) {
-    std::string msg;
+void TCPClass::put_text (char* output, size_t& output_pos, std::string_view text) {
+    std::memcpy(output + output_pos, text.data(), text.size());
+    output_pos += text.size();
+}
+
+size_t TCPClass::serialize_msg(MessageClass &data, char* out_buffer) {
+    // Message values are validated before sending, so composed message always fits into MAXLENGTH
+    size_t msg_pos = 0;
     switch (data.type) {
     case AUTH: // AUTH {Username} AS {DisplayName} USING {Secret}\r\n
-        msg = "AUTH " + data.user_name + " AS " + data.display_name + " USING " + data.secret + "\r\n";
+        put_text(out_buffer, msg_pos, "AUTH ");
+        put_text(out_buffer, msg_pos, data.user_name());
+        put_text(out_buffer, msg_pos, " AS ");
+        put_text(out_buffer, msg_pos, data.display_name());
+        put_text(out_buffer, msg_pos, " USING ");
+        put_text(out_buffer, msg_pos, data.secret());
         break;
     case JOIN: // JOIN {ChannelID} AS {DisplayName}\r\n
-        msg = "JOIN " + data.channel_id + " AS " + data.display_name + "\r\n";
+        put_text(out_buffer, msg_pos, "JOIN ");
+        put_text(out_buffer, msg_pos, data.channel_id());
+        put_text(out_buffer, msg_pos, " AS ");
+        put_text(out_buffer, msg_pos, data.display_name());
         break;
     case MSG: // MSG FROM {DisplayName} IS {MessageContent}\r\n
-        msg = "MSG FROM " + data.display_name + " IS " + data.message + "\r\n";
+        put_text(out_buffer, msg_pos, "MSG FROM ");
+        put_text(out_buffer, msg_pos, data.display_name());
+        put_text(out_buffer, msg_pos, " IS ");
+        put_text(out_buffer, msg_pos, data.message());
         break;
     case ERR: // ERR FROM {DisplayName} IS {MessageContent}\r\n
-        msg = "ERR FROM " + data.display_name + " IS " + data.message + "\r\n";
+        put_text(out_buffer, msg_pos, "ERR FROM ");
+        put_text(out_buffer, msg_pos, data.display_name());
+        put_text(out_buffer, msg_pos, " IS ");
+        put_text(out_buffer, msg_pos, data.message());
         break;
     case BYE: // BYE\r\n
-        msg = "BYE\r\n";
+        put_text(out_buffer, msg_pos, "BYE");
         break;
     default: // Shouldnt happen as type is not user-provided
-        break;
+        return 0;
     }
-    // Return composed message
-    return msg;
+    put_text(out_buffer, msg_pos, "\r\n");
+    // Return size of composed message
+    return msg_pos;
 }
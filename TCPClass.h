@@ -2,48 +2,71 @@
 #define TCPCLASS_H
 
 #include "ClientClass.h"
+#include "FramerClass.h"
+#include "TokenizerClass.h"
+#include "SendQueueClass.h"
 
+// Receive buffers of io_uring engine, stream chunks are copied to framer right away so few are enough
+#define TCP_URING_BUFFERS 64
+#define TCP_URING_BUFFER_SIZE (16 * 1024)
+
+// Message whose send was submitted to io_uring, kept for trace till it completes
 typedef struct {
-    uint8_t type             = NO_TYPE; // 1 byte
-    bool result              = false;   // 1 byte
-    std::string message      = "";      // N bytes
-    std::string user_name    = "";      // N bytes
-    std::string display_name = "";      // N bytes
-    std::string secret       = "";      // N bytes
-    std::string channel_id   = "";      // N bytes
-} TCP_DataStruct;
+    uint16_t msg_id;
+    uint8_t type;
+} UringSent;
 
 class TCPClass : public ClientClass {
+    // Codec microbenchmarks (make bench) measure private serialization methods
+    friend class CodecBenchClass;
+
     private:
-        // Vector for storing words of received message
-        std::vector<std::string> line_vec;
+        // Received data not processed yet
+        FramerClass framer;
+        // TCP has no msg_id on the wire, sent and received messages are numbered locally so trace can follow them
+        std::atomic<uint16_t> msg_id;
+        uint16_t received_count;
 
-        std::queue<TCP_DataStruct> messages_to_send;
+        // Send thread io_uring state - serialized messages and the ones submitted from them
+        std::vector<char> uring_out;
+        std::vector<UringSent> uring_sent;
 
-        void send_message (TCP_DataStruct& data);
-        void send_data (TCP_DataStruct& data);
+        bool send_message (MessageClass* data, bool priority = false);
+        void send_data (MessageClass& data);
+        void queue_data (MessageClass& data);
+        void flush_queued ();
         void send_err (std::string err_msg);
+        void send_queued ();
+        SessionTaskClass deliver (MessageClass* to_send) override;
         void handle_send ();
         void handle_receive ();
         /* Helper methods */
-        void switch_to_error (std::string err_msg);
-        MSG_TYPE get_msg_type (std::string first_msg_word);
-        std::string convert_to_string (TCP_DataStruct& data);
-        void deserialize_msg(TCP_DataStruct& out_str);
-        std::string load_rest (size_t start_from);
+        bool receive_chunk (int flags);
+        void process_frames ();
+        bool uring_receive ();
+        bool can_send_next ();
+        void abandon_sent () override;
+        bool reply_expected (uint16_t ref_msg_id) override;
+        void reply_finished () override;
+        void switch_to_error (std::string err_msg) override;
+        size_t serialize_msg (MessageClass& data, char* out_buffer);
+        void put_text (char* output, size_t& output_pos, std::string_view text);
+        void deserialize_msg(std::string_view frame, MessageClass& out_str);
 
     public:
         TCPClass (std::map<std::string, std::string> data_map);
         ~TCPClass () {};
         // Inherited methods from parent ClientClass class
         void open_connection () override;
-        void send_auth (std::string user_name, std::string display_name, std::string secret) override;
-        void send_msg (std::string msg) override;
-        void send_join (std::string channel_id) override;
+        bool send_auth (std::string_view user_name, std::string_view display_name, std::string_view secret) override;
+        bool send_msg (std::string_view msg) override;
+        bool send_join (std::string_view channel_id) override;
         void send_bye () override;
         void send_priority_bye () override;
         void session_end () override;
         bool send_rename (std::string new_display_name) override;
+        void send_pending () override;
+        void receive_pending () override;
     };
 
 #endif // TCPCLASS_H
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef TIMERCLASS_H
+#define TIMERCLASS_H
+
+#include "ConstsFile.h"
+
+// Deadlines of outstanding messages kept in min-heap, earliest deadline on top. Heap keeps its storage
+// and each msg_id has generation number telling which of its heap entries is current, so once heap grew
+// to the window size arming and cancelling deadlines doesnt allocate
+class TimerClass {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        TimerClass ()
+        : generations (0x10000, 0)
+        {
+        }
+
+        // Sets (or moves) deadline for given msg_id
+        void arm (uint16_t msg_id, clock::time_point deadline) {
+            this->deadlines.push_back({deadline, msg_id, ++this->generations[msg_id]});
+            std::push_heap(this->deadlines.begin(), this->deadlines.end(), later);
+        }
+        // Removes deadline for given msg_id, its heap entry is dropped lazily once on top
+        void cancel (uint16_t msg_id) {
+            ++this->generations[msg_id];
+        }
+        // Removes all deadlines
+        void clear () {
+            this->deadlines.clear();
+        }
+        // Returns true when there is no deadline to wait for
+        bool empty () {
+            drop_cancelled();
+            return this->deadlines.empty();
+        }
+        // Returns earliest active deadline, check empty() first
+        clock::time_point next_deadline () {
+            drop_cancelled();
+            return this->deadlines.front().deadline;
+        }
+        // Removes all deadlines already expired at given time and stores their msg_ids to expired
+        void pop_expired (clock::time_point now, std::vector<uint16_t>& expired) {
+            expired.clear();
+            while (empty() == false && this->deadlines.front().deadline <= now) {
+                expired.push_back(this->deadlines.front().msg_id);
+                ++this->generations[this->deadlines.front().msg_id];
+                pop();
+            }
+        }
+
+    private:
+        typedef struct {
+            clock::time_point deadline;
+            uint16_t msg_id;
+            uint32_t generation;
+        } Entry;
+
+        // Heap comparator, earliest deadline ends on top
+        static bool later (const Entry& first, const Entry& second) {
+            return first.deadline > second.deadline;
+        }
+        void pop () {
+            std::pop_heap(this->deadlines.begin(), this->deadlines.end(), later);
+            this->deadlines.pop_back();
+        }
+        // Heap entry is valid only if it is the last one armed for its msg_id and wasnt cancelled since
+        void drop_cancelled () {
+            while (this->deadlines.empty() == false &&
+                   this->deadlines.front().generation != this->generations[this->deadlines.front().msg_id])
+                pop();
+        }
+
+        std::vector<Entry> deadlines;
+        std::vector<uint32_t> generations;
+};
+
+#endif // TIMERCLASS_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef TOKENIZERCLASS_H
+#define TOKENIZERCLASS_H
+
+#include "ConstsFile.h"
+
+#include <string_view>
+
+// Splits received frames into fields and matches protocol keywords without any allocation.
+// Keywords are compared as integers packed from their length and upper-cased bytes,
+// so whole case-insensitive match is single switch evaluated against compile-time constants.
+class TokenizerClass {
+    public:
+        // Longest keyword that can be packed into 64-bit integer together with its length
+        static constexpr size_t MAX_KEYWORD = 7;
+
+        // Packs word length and its letters folded to upper case into integer, 0 for too long word
+        static constexpr uint64_t fold (std::string_view word) {
+            if (word.size() > MAX_KEYWORD)
+                return 0;
+            uint64_t packed = word.size();
+            for (char letter : word)
+                packed = (packed << 8) | static_cast<uint8_t>((letter >= 'a' && letter <= 'z') ? letter - ('a' - 'A') : letter);
+            return packed;
+        }
+        // Case-insensitive comparison of word with upper case keyword
+        static constexpr bool is_keyword (std::string_view word, std::string_view keyword) {
+            return word.size() <= MAX_KEYWORD && fold(word) == fold(keyword);
+        }
+        // Returns message type named by first word of TCP message
+        static constexpr MSG_TYPE msg_type (std::string_view word) {
+            switch (fold(word)) {
+                case fold("REPLY"): return REPLY;
+                case fold("AUTH"):  return AUTH;
+                case fold("JOIN"):  return JOIN;
+                case fold("MSG"):   return MSG;
+                case fold("ERR"):   return ERR;
+                case fold("BYE"):   return BYE;
+                default:            return NO_TYPE;
+            }
+        }
+        // Splits line by delim into at most max_fields views, last one holds the rest of line.
+        // Returns number of stored fields
+        static size_t split (std::string_view line, std::string_view* fields, size_t max_fields, char delim) {
+            size_t count = 0;
+            while (count + 1 < max_fields) {
+                size_t delim_pos = line.find(delim);
+                if (delim_pos == std::string_view::npos)
+                    break;
+                fields[count++] = line.substr(0, delim_pos);
+                line.remove_prefix(delim_pos + 1);
+            }
+            fields[count++] = line;
+            return count;
+        }
+};
+
+// Keywords have to be distinguishable after folding
+static_assert(TokenizerClass::msg_type("reply") == REPLY && TokenizerClass::msg_type("Bye") == BYE);
+static_assert(TokenizerClass::msg_type("BYEE") == NO_TYPE && TokenizerClass::msg_type("") == NO_TYPE);
+
+#endif // TOKENIZERCLASS_H
\ No newline at end of file
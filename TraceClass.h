@@ -0,0 +1,219 @@
+#ifndef TRACECLASS_H
+#define TRACECLASS_H
+
+#include <atomic>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// Points of message lifecycle recorded by tracing
+enum TRACE_EVENT : uint8_t {
+    T_INPUT = 0,   // User line taken for processing
+    T_RESUME,      // Client allowed loading next user line
+    T_ENQUEUE,     // Message appended to messages_to_send
+    T_SEND,        // Message written to socket (CONFIRM under msg_id it confirms)
+    T_RETRANSMIT,  // UDP message resent under msg_id, value holds its previous msg_id
+    T_CONFIRM,     // UDP CONFIRM of sent message received, value holds msg_id it referred to
+    T_REPLY,       // REPLY to sent AUTH/JOIN received
+    T_RECEIVE,     // Message received from server (UDP datagram, TCP frame)
+    T_DESERIALIZE, // Received message parsed
+    T_OUTPUT,      // Received event handed to writer
+    T_WRITE,       // Writer wrote lines out, value holds their count
+    T_COUNT
+};
+
+// Single recorded event, written to trace file as is
+typedef struct {
+    uint64_t timestamp_ns; // Steady clock
+    uint32_t value;
+    uint16_t msg_id;       // UDP msg_id, TCP messages are numbered locally
+    uint8_t event;
+    uint8_t msg_type;
+} TraceRecord;
+
+// Trace file starts with header, then chunks of records follow, each preceded by TraceChunk.
+// All numbers are in host byte order
+#define TRACE_MAGIC "IPKTRACE"
+#define TRACE_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} TraceHeader;
+
+typedef struct {
+    char thread_name[16];
+    uint32_t thread;   // Index of thread in order of its first record
+    uint32_t count;    // Number of records following
+    uint64_t dropped;  // Records thread dropped so far because its ring was full
+} TraceChunk;
+
+// Records per thread kept till flusher writes them
+#define TRACE_RING_SIZE 16384
+
+// Opt-in tracing of message lifecycle. Every thread records into its own ring, single producer
+// (the thread) and single consumer (flusher thread) need no lock. Flusher writes rings to file
+// every few milliseconds while events come and at exit, idle flusher sleeps till the next one.
+// Disabled tracing costs one relaxed load per event
+class TraceClass {
+    public:
+        // Opens trace file and starts recording, false if file cant be opened
+        static bool start (const std::string& path) {
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0)
+                return false;
+            TraceHeader header = {};
+            std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+            header.version = TRACE_VERSION;
+            header.record_size = sizeof(TraceRecord);
+            if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+                close(fd);
+                return false;
+            }
+
+            output_fd = fd;
+            enabled.store(true, std::memory_order_relaxed);
+            flusher = std::thread(run_flusher);
+            // Runs after statics created later (writer) are gone, so their last records get written too
+            std::atexit(stop);
+            return true;
+        }
+        // Stops recording and writes everything recorded so far
+        static void stop () {
+            if (flusher.joinable() == false)
+                return;
+            enabled.store(false, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(flusher_mutex);
+                stopping = true;
+            }
+            flusher_cond_var.notify_one();
+            flusher.join();
+            flush_rings();
+            close(output_fd);
+        }
+        static void record (TRACE_EVENT event, uint16_t msg_id = 0, uint8_t msg_type = 0, uint32_t value = 0) {
+            if (enabled.load(std::memory_order_relaxed) == false)
+                return;
+            append(event, msg_id, msg_type, value);
+        }
+        // Names calling thread in trace, has to be called before its first record
+        static void set_thread_name (const char* name) {
+            std::strncpy(thread_name, name, sizeof(thread_name) - 1);
+        }
+
+    private:
+        typedef struct {
+            std::array<TraceRecord, TRACE_RING_SIZE> records;
+            // Written by owner thread only
+            std::atomic<uint64_t> head = 0;
+            std::atomic<uint64_t> dropped = 0;
+            // Written by flusher only
+            std::atomic<uint64_t> tail = 0;
+            uint32_t thread = 0;
+            char name[16] = {};
+        } TraceRing;
+
+        static inline std::atomic<bool> enabled = false;
+        static inline int output_fd = -1;
+        static inline std::thread flusher;
+        static inline std::mutex flusher_mutex;
+        static inline std::condition_variable flusher_cond_var;
+        static inline bool stopping = false;
+        // Flusher sleeps without timeout, first record wakes it up
+        static inline std::atomic<bool> flusher_idle = false;
+        // Rings outlive their threads, so records of finished threads get written too
+        static inline std::mutex rings_mutex;
+        static inline std::vector<std::unique_ptr<TraceRing>> rings;
+        static inline thread_local char thread_name[16] = "thread";
+
+        static void append (TRACE_EVENT event, uint16_t msg_id, uint8_t msg_type, uint32_t value) {
+            thread_local TraceRing* ring = add_ring();
+            uint64_t head = ring->head.load(std::memory_order_relaxed);
+            if (head - ring->tail.load(std::memory_order_acquire) >= TRACE_RING_SIZE) {
+                // Flusher is behind, drop rather than block the thread being traced
+                ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+            uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            ring->records[head % TRACE_RING_SIZE] = {now, value, msg_id, event, msg_type};
+            ring->head.store(head + 1, std::memory_order_release);
+
+            // Flusher either sees this record after going idle or is woken up here
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (flusher_idle.load(std::memory_order_relaxed) == true && flusher_idle.exchange(false) == true) {
+                std::lock_guard<std::mutex> lock(flusher_mutex);
+                flusher_cond_var.notify_one();
+            }
+        }
+        // Ring of calling thread, created and registered by its first record
+        static TraceRing* add_ring () {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            TraceRing* ring = rings.emplace_back(std::make_unique<TraceRing>()).get();
+            ring->thread = static_cast<uint32_t>(rings.size() - 1);
+            std::memcpy(ring->name, thread_name, sizeof(ring->name));
+            return ring;
+        }
+        static void run_flusher () {
+            std::unique_lock<std::mutex> lock(flusher_mutex);
+            while (stopping == false) {
+                flusher_cond_var.wait_for(lock, std::chrono::milliseconds(10));
+                lock.unlock();
+                if (flush_rings() == false) {
+                    // Nothing recorded for whole period, recheck after announcing idleness so no record is missed
+                    flusher_idle.store(true);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (flush_rings() == true)
+                        flusher_idle.store(false);
+                }
+                lock.lock();
+                flusher_cond_var.wait(lock, [] {
+                    return (stopping == true || flusher_idle.load() == false);
+                });
+            }
+        }
+        // Writes records waiting in all rings, each ring as single chunk. False if there was none
+        static bool flush_rings () {
+            bool written = false;
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            for (auto& ring : rings) {
+                uint64_t head = ring->head.load(std::memory_order_acquire);
+                uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                if (head == tail)
+                    continue;
+
+                TraceChunk chunk = {};
+                std::memcpy(chunk.thread_name, ring->name, sizeof(chunk.thread_name));
+                chunk.thread = ring->thread;
+                chunk.count = static_cast<uint32_t>(head - tail);
+                chunk.dropped = ring->dropped.load(std::memory_order_relaxed);
+
+                // Waiting records may wrap around the end of ring
+                size_t first = tail % TRACE_RING_SIZE;
+                size_t first_count = std::min<size_t>(chunk.count, TRACE_RING_SIZE - first);
+                struct iovec iovs[3] = {
+                    {&chunk, sizeof(chunk)},
+                    {&ring->records[first], first_count * sizeof(TraceRecord)},
+                    {&ring->records[0], (chunk.count - first_count) * sizeof(TraceRecord)}
+                };
+                if (writev(output_fd, iovs, 3) < 0)
+                    return written;
+                ring->tail.store(head, std::memory_order_release);
+                written = true;
+            }
+            return written;
+        }
+};
+
+#endif // TRACECLASS_H
\ No newline at end of file
@@ -4,7 +4,9 @@ UDPClass::UDPClass (std::map<std::string, std::string> data_map)
     : ClientClass    (),
       msg_id         (0),
       recon_attempts (3),
-      timeout        (250)
+      timeout        (250),
+      window_size    (1),
+      batch_size     (16)
 {
     std::map<std::string, std::string>::iterator iter;
     // Look for init values in map to override init values
@@ -19,6 +21,20 @@ UDPClass::UDPClass (std::map<std::string, std::string> data_map)
 
     if ((iter = data_map.find("timeout")) != data_map.end())
         this->timeout = static_cast<uint16_t>(std::stoi(iter->second));
+
+    if ((iter = data_map.find("window")) != data_map.end())
+        this->window_size = static_cast<uint16_t>(std::max(1, std::stoi(iter->second)));
+
+    if ((iter = data_map.find("batch")) != data_map.end())
+        this->batch_size = static_cast<uint16_t>(std::clamp(std::stoi(iter->second), 1, IOV_MAX));
+
+    if ((iter = data_map.find("engine")) != data_map.end()) {
+        this->use_threads = (iter->second != std::string("epoll"));
+        this->use_uring = (iter->second == std::string("uring"));
+    }
+
+    // Timeout given by user is initial retransmission timeout
+    this->rtt.init(std::chrono::milliseconds(this->timeout));
 }
 /***********************************************************************************/
 void UDPClass::open_connection () {
@@ -43,8 +59,29 @@ void UDPClass::open_connection () {
     // Store to class
     this->sock_str = server_addr;
 
-    // Set proper timeout
-    set_socket_timeout(this->timeout);
+    // Buffers for batch of datagrams received with single syscall
+    this->in_buffers.resize(this->batch_size * MAXLENGTH);
+    this->in_iovs.resize(this->batch_size);
+    this->in_msgs.resize(this->batch_size);
+    this->in_addrs.resize(this->batch_size);
+    this->in_datagrams.reserve(this->batch_size);
+    this->confirms.reserve(this->batch_size);
+    this->confirms_batch.reserve(this->batch_size);
+    // Msgs to be sent to server with single syscall
+    this->batch.reserve(this->batch_size);
+    // Every message is either queued, in flight or just being moved between them (ERR and BYE may exceed the window)
+    this->pool.init(SendQueueClass<MessageClass*>::CAPACITY + this->window_size + 8);
+    this->in_flight.reserve(this->window_size + 2);
+
+    // Event loop engine drives the client by itself, session runs as coroutines
+    if (this->use_threads == false) {
+        this->confirm_waits.reserve(this->window_size + 2);
+        start_session(this->window_size + 2);
+        return;
+    }
+
+    // Session end wakes waiting threads right away, no timeout is needed
+    open_stop_event();
 
     // Create threads for sending and receiving server msgs
     this->send_thread = std::jthread(&UDPClass::handle_send, this);
@@ -56,52 +93,47 @@ void UDPClass::session_end () {
     this->stop_send = true;
     // Notify send thread
     this->send_cond_var.notify_one();
+    // Wake receive and user input threads
+    signal_stop();
     // Change state
     this->cur_state = S_END;
     // Close socket
     close(this->socket_id);
     // Exit the program by notifying main function
     this->end_program = true;
-    this->cond_var.notify_one();
+    notify_main();
     // Ensure stopping of user input handling thread
-    this->load_input = true;
-    this->input_cond_var.notify_one();
+    allow_user_input();
 }
 /***********************************************************************************/
-void UDPClass::send_auth (std::string user, std::string display, std::string secret) {
+bool UDPClass::send_auth (std::string_view user, std::string_view display, std::string_view secret) {
     // Update display name
-    if (send_rename(display) == false)
-        return;
+    if (send_rename(std::string(display)) == false)
+        return false;
 
-    UDP_DataStruct data = {
-        .header = create_header(AUTH),
-        .user_name = user,
-        .display_name = display,
-        .secret = secret
-    };
-    send_message(data);
+    MessageClass* data = create_msg(AUTH);
+    data->set(P_USER_NAME, user);
+    data->set(P_DISPLAY_NAME, display);
+    data->set(P_SECRET, secret);
+    return send_message(data);
 }
 /***********************************************************************************/
-void UDPClass::send_msg (std::string msg) {
-    UDP_DataStruct data = {
-        .header = create_header(MSG),
-        .message = msg,
-        .display_name = this->display_name
-    };
-    send_message(data);
+bool UDPClass::send_msg (std::string_view msg) {
+    MessageClass* data = create_msg(MSG);
+    data->set(P_DISPLAY_NAME, this->display_name);
+    data->set(P_MESSAGE, msg);
+    return send_message(data);
 }
 /***********************************************************************************/
-void UDPClass::send_join (std::string channel_id) {
-    UDP_DataStruct data = {
-        .header = create_header(JOIN),
-        .display_name = this->display_name,
-        .channel_id = channel_id
-    };
-    send_message(data);
+bool UDPClass::send_join (std::string_view channel_id) {
+    MessageClass* data = create_msg(JOIN);
+    data->set(P_CHANNEL_ID, channel_id);
+    data->set(P_DISPLAY_NAME, this->display_name);
+    return send_message(data);
 }
 /***********************************************************************************/
 bool UDPClass::send_rename (std::string new_display_name) {
-    if (regex_match(new_display_name, display_name_pattern) == false) {
+    if (ValidatorClass::display_name(new_display_name) == false) {
         OutputClass::out_err_intern("Invalid new value for display name");
         return false;
     }
@@ -110,350 +142,808 @@ bool UDPClass::send_rename (std::string new_display_name) {
     return true;
 }
 /***********************************************************************************/
-void UDPClass::send_confirm (uint16_t confirm_to_id) {
-    UDP_DataStruct data = {
-        .header = create_header(CONFIRM),
-        .ref_msg_id = confirm_to_id
-    };
-    // Send confirm immediately
-    send_data(data);
-}
-/***********************************************************************************/
 void UDPClass::send_bye () {
     // Send bye message
-    UDP_DataStruct data = {
-        .header = create_header(BYE)
-    };
-    send_message(data);
+    send_message(create_msg(BYE));
 }
 /***********************************************************************************/
 void UDPClass::send_priority_bye () {
-    this->high_priority = true;
     // Switch to END state
     this->cur_state = S_END;
-    send_bye();
+
+    send_message(create_msg(BYE), true);
 }
 /***********************************************************************************/
 void UDPClass::send_err (std::string err_msg) {
     // Switch to err state
     this->cur_state = S_ERROR;
 
-    UDP_DataStruct data = {
-        .header = create_header(ERR),
-        .message = err_msg,
-        .display_name = this->display_name
-    };
-    send_message(data);
+    MessageClass* data = create_msg(ERR);
+    data->set(P_DISPLAY_NAME, this->display_name);
+    data->set(P_MESSAGE, err_msg);
+    send_message(data, true);
 }
 /***********************************************************************************/
-void UDPClass::set_socket_timeout (uint16_t timeout /*miliseconds*/) {
-    struct timeval time = {
-        .tv_sec = 0,
-        .tv_usec = suseconds_t(timeout * 1000)
-    };
-    // Set timeout for created socket
-    if (setsockopt(this->socket_id, SOL_SOCKET, SO_RCVTIMEO, (char*)&(time), sizeof(struct timeval)) < 0)
-        throw std::logic_error("Setting receive timeout failed");
-}
-/***********************************************************************************/
-void UDPClass::send_message (UDP_DataStruct data) {
+bool UDPClass::send_message (MessageClass* data, bool priority) {
     // Check for message validity
-    if (check_valid_msg<UDP_DataStruct>(data.header.type, data) == false) {
+    if (check_valid_msg(*data) == false) {
+        this->pool.release(data);
         OutputClass::out_err_intern("Invalid content of message provided, wont send");
-        return;
-    }
-    // Avoid racing between main and response thread
-    {
-        std::lock_guard<std::mutex> lock(this->editing_front_mutex);
-        if (this->high_priority == true) {
-            // Clear the queue
-            this->messages_to_send = {};
-            // Reset waiting for reply flag
-            this->wait_for_reply = false;
-            // Reset priority flag after using
-            this->high_priority = false;
-        }
-        // Add new message to the queue with given resend count
-        this->messages_to_send.push({data, this->recon_attempts + 1/*initial try*/});
+        return false;
     }
+    data->sends_left = this->recon_attempts + 1/*initial try*/;
+    TraceClass::record(T_ENQUEUE, data->msg_id, data->type);
+    // Add new message to the queue, queue is safe to use from any thread without locking
+    if (priority == true)
+        this->messages_to_send.push_priority(std::move(data));
+    else
+        this->messages_to_send.push(std::move(data));
+    // Wake up sending thread
+    notify_sender();
+    return true;
 }
 /***********************************************************************************/
-void UDPClass::send_data (UDP_DataStruct& data) {
+void UDPClass::send_data (MessageClass& data) {
     // Prepare data to send
-    std::string message = convert_to_string(data);
-    const char* out_buffer = message.data();
+    char out_buffer[MAXLENGTH];
+    size_t out_size = serialize_msg(data, out_buffer);
 
     // Send data
     ssize_t bytes_send =
-        sendto(this->socket_id, out_buffer, message.size(), 0, (struct sockaddr*)&(this->sock_str), sizeof(this->sock_str));
+        sendto(this->socket_id, out_buffer, out_size, 0, (struct sockaddr*)&(this->sock_str), sizeof(this->sock_str));
+    MetricsClass::count(C_SEND_SYSCALLS);
 
     // Check for errors
     if (bytes_send < 0)
         OutputClass::out_err_intern("Error while sending data to server");
-    else // Mark msg as sent
+    else { // Mark msg as sent
         data.sent = true;
+        MetricsClass::count(C_MSGS_SENT);
+        TraceClass::record(T_SEND, data.msg_id, data.type);
+    }
+}
+/***********************************************************************************/
+void UDPClass::send_data_batch (std::vector<MessageClass*>& batch, UringClass* ring) {
+    // Buffers are reused by each thread for all its batches
+    thread_local std::vector<char> out_buffers;
+    thread_local std::vector<struct iovec> out_iovs;
+    thread_local std::vector<struct mmsghdr> out_msgs;
+    out_buffers.resize(std::max(out_buffers.size(), batch.size() * MAXLENGTH));
+    out_iovs.resize(std::max(out_iovs.size(), batch.size()));
+    out_msgs.resize(std::max(out_msgs.size(), batch.size()));
+
+    // Prepare data to send
+    for (size_t index = 0; index < batch.size(); ++index) {
+        char* out_buffer = out_buffers.data() + index * MAXLENGTH;
+        out_iovs[index] = {
+            .iov_base = out_buffer,
+            .iov_len  = serialize_msg(*batch[index], out_buffer)
+        };
+        out_msgs[index] = {};
+        out_msgs[index].msg_hdr.msg_name    = &(this->sock_str);
+        out_msgs[index].msg_hdr.msg_namelen = sizeof(this->sock_str);
+        out_msgs[index].msg_hdr.msg_iov     = &out_iovs[index];
+        out_msgs[index].msg_hdr.msg_iovlen  = 1;
+    }
+
+    if (ring != nullptr && ring->active() == true) {
+        // Submit whole batch and wait till all of it is sent with single syscall, slot is index in batch
+        for (size_t index = 0; index < batch.size(); ++index)
+            ring->prepare_sendmsg(this->socket_id, &out_msgs[index].msg_hdr, UringClass::tag(URING_SEND, index));
+        MetricsClass::count(C_SEND_SYSCALLS);
+        if (ring->submit(batch.size()) < 0) {
+            OutputClass::out_err_intern("Error while sending data to server");
+            return;
+        }
+        ring->take_completions(this->send_completions);
+        for (const UringCompletion& completion : this->send_completions) {
+            if (completion.result < 0) {
+                OutputClass::out_err_intern("Error while sending data to server");
+                continue;
+            }
+            MessageClass* sent = batch[UringClass::slot(completion.user_data)];
+            sent->sent = true;
+            TraceClass::record(T_SEND, sent->msg_id, sent->type);
+            MetricsClass::count(C_MSGS_SENT);
+        }
+        return;
+    }
+
+    // Send data, kernel may send only part of the batch at once
+    size_t sent_count = 0;
+    while (sent_count < batch.size()) {
+        int result = sendmmsg(this->socket_id, out_msgs.data() + sent_count, batch.size() - sent_count, 0);
+        MetricsClass::count(C_SEND_SYSCALLS);
+        // Check for errors
+        if (result <= 0) {
+            OutputClass::out_err_intern("Error while sending data to server");
+            return;
+        }
+        // Mark msgs as sent
+        for (int index = 0; index < result; ++index) {
+            MessageClass* sent = batch[sent_count + index];
+            sent->sent = true;
+            TraceClass::record(T_SEND, (sent->type == CONFIRM) ? sent->ref_msg_id : sent->msg_id, sent->type);
+        }
+        sent_count += result;
+        MetricsClass::count(C_MSGS_SENT, result);
+    }
 }
 /***********************************************************************************/
 void UDPClass::handle_send () {
+    TraceClass::set_thread_name("send");
+    // Without io_uring batches go through sendmmsg
+    if (this->use_uring == true)
+        this->send_ring.init();
     while (this->stop_send == false) {
-        std::unique_lock<std::mutex> sendlock(this->send_mutex);
-        this->send_cond_var.wait(sendlock, [&] {
-            return (!this->messages_to_send.empty() || this->stop_send);
-        });
-
         // Avoid racing when reading from queue
         std::unique_lock<std::mutex> lock(this->editing_front_mutex);
-
-        // Nothing to send/blocked to send anything atm (waiting for server reply)
-        if (this->messages_to_send.empty() == true || this->wait_for_reply == true)
-            continue;
+        auto wake_up = [&] {
+            return (can_send_next() || this->stop_send ||
+                    (this->timers.empty() == false && this->timers.next_deadline() <= TimerClass::clock::now()));
+        };
+        // Sleep till there is something to send or earliest deadline expires
+        if (this->timers.empty() == true)
+            wait_sender(lock, wake_up);
+        else
+            wait_sender(lock, wake_up, this->timers.next_deadline());
 
         // Stop sending if requested
         if (this->stop_send == true)
             break;
 
-        // Load message to send from queue front
-        auto& to_send = this->messages_to_send.front();
+        // Handle expired deadlines outside of lock as they may enqueue new messages
+        this->timers.pop_expired(TimerClass::clock::now(), this->expired_ids);
+        if (this->expired_ids.empty() == false) {
+            lock.unlock();
+            for (uint16_t expired_id : this->expired_ids)
+                thread_event(TIMEOUT, expired_id);
+            continue;
+        }
 
-        // Avoid sending multiple msgs with the same msg_id
-        if (to_send.first.sent == false) {
-            // Check if given message can be send in client's current state
-            if (check_msg_context(to_send.first.header.type, this->cur_state) == false) {
-                OutputClass::out_err_intern("Sending this type of message is prohibited for current client state");
-                // Remove this message from queue
-                this->messages_to_send.pop();
-                continue;
-            }
+        send_window();
+    }
+}
+/***********************************************************************************/
+void UDPClass::send_pending () {
+    // Expired retransmission deadlines wake deliveries waiting for CONFIRM
+    this->timers.pop_expired(TimerClass::clock::now(), this->expired_ids);
+    for (uint16_t expired_id : this->expired_ids)
+        wake_confirm(expired_id, false);
+
+    run_session();
+    // Messages put on the wire by the session go out together
+    if (this->stop_send == false)
+        flush_batch();
+}
+/***********************************************************************************/
+bool UDPClass::next_deadline (std::chrono::steady_clock::time_point& deadline) {
+    // REPLY deadline of the session
+    bool found = ClientClass::next_deadline(deadline);
+    std::lock_guard<std::mutex> lock(this->editing_front_mutex);
+    if (this->timers.empty() == true)
+        return found;
+    deadline = (found == true) ? std::min(deadline, this->timers.next_deadline()) : this->timers.next_deadline();
+    return true;
+}
+/***********************************************************************************/
+SessionTaskClass UDPClass::deliver (MessageClass* to_send) {
+    // Keep it until confirmed by server
+    this->in_flight.push_back(to_send);
+    // Store its id to check for matching reply ref_msg_id from server
+    expect_reply(to_send->msg_id, to_send->type);
+    // Send it to server together with other msgs
+    this->batch.push_back(to_send);
+    if (this->batch.size() >= this->batch_size)
+        flush_batch();
+
+    // Each transmission waits for its CONFIRM, timeout grows with every retransmission
+    while (co_await confirm(to_send->msg_id, this->rtt.get_rto()) == false) {
+        if (to_send->sends_left <= 1) { // No reply from server -> end connection
+            MetricsClass::count(C_SEND_TIMEOUTS);
+            OutputClass::out_err_intern("No response from server, ending connection");
+            session_end();
+            co_return;
+        }
+        resend(to_send);
+    }
 
-            // Send it to server
-            send_data(to_send.first);
+    // Remove after succesful confirmation, order of in-flight messages doesnt matter
+    auto confirmed = std::find(this->in_flight.begin(), this->in_flight.end(), to_send);
+    *confirmed = this->in_flight.back();
+    this->in_flight.pop_back();
+    this->pool.release(to_send);
+}
+/***********************************************************************************/
+void UDPClass::confirm_received (uint16_t event_msg_id) {
+    auto confirmed = find_in_flight(event_msg_id);
+    // Late confirmation of message already resent with another msg_id
+    auto alias = this->resent_ids.find(event_msg_id);
+    if (confirmed == this->in_flight.end() && alias != this->resent_ids.end())
+        confirmed = find_in_flight(alias->second);
+    // Message leaves in-flight list once its delivery is resumed
+    if (confirmed != this->in_flight.end() && wake_confirm((*confirmed)->msg_id, true) == true) {
+        uint16_t confirmed_id = (*confirmed)->msg_id;
+        TraceClass::record(T_CONFIRM, confirmed_id, (*confirmed)->type, event_msg_id);
+        this->rtt.confirmed((*confirmed)->sent_at);
+        this->timers.cancel(confirmed_id);
+        forget_copies(confirmed_id, event_msg_id);
+    }
+    else if (this->superseded_ids.test(event_msg_id) == true)
+        // Another copy of already confirmed message reached the server too, nothing to deal with
+        this->superseded_ids.reset(event_msg_id);
+    else
+        OutputClass::out_err_intern("Confirmation to unexpected message received");
+}
+/***********************************************************************************/
+bool UDPClass::wake_confirm (uint16_t sent_id, bool confirmed) {
+    // Window is small, linear search is cheaper than keeping an index
+    auto waiting = std::find_if(this->confirm_waits.begin(), this->confirm_waits.end(), [&](ConfirmAwaiter* awaiter) {
+        return awaiter->msg_id == sent_id;
+    });
+    if (waiting == this->confirm_waits.end())
+        return false;
+    (*waiting)->confirmed = confirmed;
+    wake((*waiting)->handle);
+    *waiting = this->confirm_waits.back();
+    this->confirm_waits.pop_back();
+    return true;
+}
+/***********************************************************************************/
+void UDPClass::send_window () {
+    // Put as many queued messages on the wire as the send window allows
+    while (can_send_next() == true) {
+        MessageClass* to_send = *this->messages_to_send.front();
+        MetricsClass::record(H_QUEUE_DEPTH, this->messages_to_send.size());
+        if (this->messages_to_send.is_priority() == true && this->priority_taken == false)
+            abandon_sent();
+        this->messages_to_send.pop();
+
+        // Check if given message can be send in client's current state
+        if (check_msg_context(to_send->type, this->cur_state) == false) {
+            OutputClass::out_err_intern("Sending this type of message is prohibited for current client state");
+            this->pool.release(to_send);
+            continue;
+        }
 
-            // Store its id to check for matching reply ref_msg_id from server
-            this->to_reply_ids.push_back(to_send.first.header.msg_id);
+        // Store its id to check for matching reply ref_msg_id from server
+        expect_reply(to_send->msg_id, to_send->type);
+
+        // Keep it until confirmed by server
+        this->in_flight.push_back(to_send);
+
+        // Send it to server together with other msgs
+        this->batch.push_back(to_send);
+        if (this->batch.size() >= this->batch_size)
+            flush_batch();
+    }
+    flush_batch();
+    update_load_input();
+}
+/***********************************************************************************/
+void UDPClass::flush_batch () {
+    if (this->batch.empty() == true)
+        return;
+
+    send_data_batch(this->batch, &this->send_ring);
+    // Start measuring time till confirmation once really sent, messages stay in flight as lock is held.
+    // Deliveries of event loop engine arm their deadlines themselves
+    RTTClass::clock::time_point now = RTTClass::clock::now();
+    for (MessageClass* sent : this->batch) {
+        sent->sent_at = now;
+        if (this->use_threads == true)
+            this->timers.arm(sent->msg_id, now + this->rtt.get_rto());
+    }
+    this->batch.clear();
+}
+/***********************************************************************************/
+bool UDPClass::blocks_window (uint8_t type) {
+    // These messages change the session state, so they are never pipelined with others
+    return (type == AUTH || type == JOIN || type == BYE || type == ERR);
+}
+/***********************************************************************************/
+bool UDPClass::window_open (uint8_t msg_type) {
+    // Session itself waits for delivery of state changing message, so only MSGs can be in flight
+    if (this->in_flight.size() >= this->window_size)
+        return false;
+    return (this->in_flight.empty() == true || blocks_window(msg_type) == false);
+}
+/***********************************************************************************/
+void UDPClass::abandon_sent () {
+    // Session is ending, send everything collected so far and stop caring about it
+    flush_batch();
+    for (MessageClass* abandoned : this->in_flight)
+        this->pool.release(abandoned);
+    this->in_flight.clear();
+    this->confirm_waits.clear();
+    this->resent_ids.clear();
+    this->pending_replies.clear();
+    this->timers.clear();
+    // Reset waiting for reply flag
+    this->wait_for_reply = false;
+    this->priority_taken = true;
+}
+/***********************************************************************************/
+void UDPClass::forget_copies (uint16_t confirmed_id, uint16_t event_msg_id) {
+    // Server may still confirm every other copy of the message, such CONFIRM is then expected
+    for (auto alias = this->resent_ids.begin(); alias != this->resent_ids.end();) {
+        if (alias->second != confirmed_id) {
+            ++alias;
+            continue;
         }
+        if (alias->first != event_msg_id)
+            this->superseded_ids.set(alias->first);
+        alias = this->resent_ids.erase(alias);
     }
+    if (confirmed_id != event_msg_id)
+        this->superseded_ids.set(confirmed_id);
+    // Id may have been superseded before it wrapped around
+    this->superseded_ids.reset(event_msg_id);
 }
 /***********************************************************************************/
-void UDPClass::thread_event (THREAD_EVENT event, uint16_t confirm_to_id) {
-    // Timeout happened when waiting for REPLY -> end connection
-    if (event == TIMEOUT && this->wait_for_reply == true) {
-        OutputClass::out_err_intern("Timeout for server response, ending connection");
-        send_priority_bye();
-    }
-    else {
-        std::lock_guard<std::mutex> lock(this->editing_front_mutex);
-        if (this->messages_to_send.empty() == false) {
-            // Skip if messages queue is empty as nothing to deal with
-            auto& front_msg = this->messages_to_send.front();
-
-            // There is/are msgs in queue, but not send yet, ignore and avoid their resend count decrement
-            if (event == TIMEOUT && front_msg.first.sent == true) { // Timeout event occured
-                // Decrease front msg resend count
-                if (front_msg.second > 1) {
-                    // Decrease resend count
-                    front_msg.second -= 1;
-                    // Ensure msg_id uniqueness by changing it each time
-                    front_msg.first.header = create_header(front_msg.first.header.type);
-                    // Reset sent flag
-                    front_msg.first.sent = false;
-                }
-                else { // No reply from server -> end connection
-                    OutputClass::out_err_intern("No response from server, ending connection");
-                    session_end();
-                }
-            }
-            else if (event == CONFIRMATION) { // Confirmation event occured
-                if (front_msg.first.header.msg_id == confirm_to_id) { // Pop it from queue and continue with another message (if any)
-                    // Confirmed BYE msg -> end connection
-                    if (front_msg.first.header.type == BYE)
-                        session_end();
-                    else {
-                        uint8_t msg_type = front_msg.first.header.type;
-                        // Remove from queue after succesful confirmation
-                        this->messages_to_send.pop();
-
-                        if (msg_type == AUTH || msg_type == JOIN) {
-                            this->wait_for_reply = true;
-                            return;
-                        }
-                    }
-                }
-                else
-                    OutputClass::out_err_intern("Confirmation to unexpected message received");
+bool UDPClass::can_send_next () {
+    auto next = this->messages_to_send.front();
+    // Nothing to send
+    if (next == nullptr)
+        return false;
+
+    // First session ending message doesnt wait for anything sent before it
+    if (this->messages_to_send.is_priority() == true && this->priority_taken == false)
+        return true;
+
+    // Blocked to send anything atm (waiting for server reply)
+    if (this->wait_for_reply == true)
+        return false;
+
+    // Whole window is in flight
+    if (this->in_flight.size() >= this->window_size)
+        return false;
+
+    // State changing message has to wait for all previous messages to be confirmed
+    if (this->in_flight.empty() == false && blocks_window((*next)->type))
+        return false;
+
+    // Nothing else can be send while state changing message is waiting for confirmation
+    for (MessageClass* msg : this->in_flight)
+        if (blocks_window(msg->type))
+            return false;
+    return true;
+}
+/***********************************************************************************/
+std::vector<MessageClass*>::iterator UDPClass::find_in_flight (uint16_t sent_id) {
+    // Window is small, linear search is cheaper than keeping an index
+    return std::find_if(this->in_flight.begin(), this->in_flight.end(), [&](MessageClass* msg) {
+        return msg->msg_id == sent_id;
+    });
+}
+/***********************************************************************************/
+void UDPClass::update_load_input () {
+    // Allow reading next user input once all queued messages are on the wire and window has space left
+    if (this->messages_to_send.empty() && this->in_flight.size() < this->window_size && this->wait_for_reply == false) {
+        allow_user_input();
+    }
+}
+/***********************************************************************************/
+void UDPClass::expect_reply (uint16_t sent_id, uint8_t type) {
+    // Only AUTH and JOIN msgs are replied to, waiting starts with first transmission
+    if (type == AUTH || type == JOIN) {
+        if (this->pending_replies.empty() == true)
+            this->request_start = std::chrono::steady_clock::now();
+        this->pending_replies.insert(sent_id);
+    }
+}
+/***********************************************************************************/
+bool UDPClass::reply_expected (uint16_t ref_msg_id) {
+    std::lock_guard<std::mutex> lock(this->editing_front_mutex);
+    return this->pending_replies.contains(ref_msg_id);
+}
+/***********************************************************************************/
+void UDPClass::reply_finished () {
+    std::lock_guard<std::mutex> lock(this->editing_front_mutex);
+    // Request is answered, forget all msg_ids it was sent with together with its REPLY deadline.
+    // Deliveries of event loop engine still wait for CONFIRM under these ids, session keeps the deadline
+    if (this->pending_replies.empty() == false)
+        MetricsClass::record_since(H_REPLY_WAIT, this->request_start);
+    if (this->use_threads == true)
+        for (uint16_t pending_id : this->pending_replies)
+            this->timers.cancel(pending_id);
+    this->pending_replies.clear();
+    this->wait_for_reply = false;
+    update_load_input();
+    // Notify send thread
+    this->send_cond_var.notify_one();
+}
+/***********************************************************************************/
+std::chrono::milliseconds UDPClass::reply_timeout () {
+    return std::chrono::milliseconds(this->timeout);
+}
+/***********************************************************************************/
+void UDPClass::thread_event (THREAD_EVENT event, uint16_t event_msg_id) {
+    std::unique_lock<std::mutex> lock(this->editing_front_mutex);
+    if (event == TIMEOUT) { // Deadline of given message expired
+        auto expired = find_in_flight(event_msg_id);
+        if (expired == this->in_flight.end()) {
+            // Timeout happened when waiting for REPLY -> end connection
+            if (this->wait_for_reply == true) {
+                MetricsClass::count(C_REPLY_TIMEOUTS);
+                this->pending_replies.clear();
+                lock.unlock();
+                OutputClass::out_err_intern("Timeout for server response, ending connection");
+                send_priority_bye();
+                return;
             }
+            // else: Message already confirmed, nothing to deal with
+        }
+        else if ((*expired)->sends_left > 1) {
+            resend(*expired);
+            this->timers.arm((*expired)->msg_id, TimerClass::clock::now() + this->rtt.get_rto());
         }
-        if (this->messages_to_send.empty()) {
-            this->load_input = true;
-            this->input_cond_var.notify_one();
+        else { // No reply from server -> end connection
+            MetricsClass::count(C_SEND_TIMEOUTS);
+            OutputClass::out_err_intern("No response from server, ending connection");
+            session_end();
+            return;
         }
     }
+    else if (event == CONFIRMATION) { // Confirmation event occured
+        auto confirmed = find_in_flight(event_msg_id);
+        // Late confirmation of message already resent with another msg_id
+        auto alias = this->resent_ids.find(event_msg_id);
+        if (confirmed == this->in_flight.end() && alias != this->resent_ids.end())
+            confirmed = find_in_flight(alias->second);
+        if (confirmed != this->in_flight.end()) { // Remove it and continue with another message (if any)
+            uint8_t msg_type = (*confirmed)->type;
+            TraceClass::record(T_CONFIRM, (*confirmed)->msg_id, msg_type, event_msg_id);
+            // Confirmed BYE msg -> end connection
+            if (msg_type == BYE) {
+                session_end();
+                return;
+            }
+            // Remove after succesful confirmation, order of in-flight messages doesnt matter
+            uint16_t confirmed_id = (*confirmed)->msg_id;
+            this->rtt.confirmed((*confirmed)->sent_at);
+            this->pool.release(*confirmed);
+            *confirmed = this->in_flight.back();
+            this->in_flight.pop_back();
+            this->timers.cancel(confirmed_id);
+            forget_copies(confirmed_id, event_msg_id);
+
+            if (msg_type == AUTH || msg_type == JOIN) {
+                this->wait_for_reply = true;
+                // Server has to REPLY in time
+                this->timers.arm(confirmed_id, TimerClass::clock::now() + std::chrono::milliseconds(this->timeout));
+            }
+        }
+        else if (this->superseded_ids.test(event_msg_id) == true)
+            // Another copy of already confirmed message reached the server too, nothing to deal with
+            this->superseded_ids.reset(event_msg_id);
+        else
+            OutputClass::out_err_intern("Confirmation to unexpected message received");
+    }
+    update_load_input();
+    lock.unlock();
     // Notify waiting thread (if any)
     this->send_cond_var.notify_one();
 }
 /***********************************************************************************/
+void UDPClass::resend (MessageClass* to_resend) {
+    uint16_t expired_id = to_resend->msg_id;
+    // Confirmation of resent message cant be used for measurement, back off instead
+    to_resend->sent_at = RTTClass::clock::time_point();
+    this->rtt.backoff();
+    MetricsClass::count(C_RETRANSMITS);
+    // Decrease resend count
+    to_resend->sends_left -= 1;
+    // Ensure msg_id uniqueness by changing it each time, message stays in flight under the new one
+    to_resend->msg_id = create_msg_id();
+    TraceClass::record(T_RETRANSMIT, to_resend->msg_id, to_resend->type, expired_id);
+    // Send it again
+    send_data(*to_resend);
+    expect_reply(to_resend->msg_id, to_resend->type);
+
+    // All earlier ids of the message point to the one it is in flight under now
+    for (auto& alias : this->resent_ids)
+        if (alias.second == expired_id)
+            alias.second = to_resend->msg_id;
+    this->resent_ids[expired_id] = to_resend->msg_id;
+}
+/***********************************************************************************/
 void UDPClass::handle_receive () {
-    char in_buffer[MAXLENGTH];
-    socklen_t sock_len = sizeof(this->sock_str);
+    TraceClass::set_thread_name("receive");
+    // Plain syscalls are used when io_uring isnt available
+    if (this->use_uring == true && uring_receive() == true)
+        return;
 
+    struct pollfd fds[2] = {
+        {.fd = this->socket_id, .events = POLLIN, .revents = 0},
+        {.fd = this->stop_fd,   .events = POLLIN, .revents = 0}
+    };
     while (this->stop_recv == false) {
-        ssize_t bytes_received =
-            recvfrom(this->socket_id, (char*)in_buffer, MAXLENGTH, 0, (struct sockaddr*)&this->sock_str, &sock_len);
-
-        // Stop receiving when requested
-        if (this->stop_recv == true)
-            break;
-
-        if (bytes_received < 3) { // Smaller then compulsory header size (3B)
-            if ((errno == EWOULDBLOCK || errno == EAGAIN)) // Timeout event
-                thread_event(TIMEOUT);
-            else if (bytes_received < 0) // Output error
-                OutputClass::out_err_intern("Error while receiving data from server");
-            else // 0 <= size < 3 -> send ERR, BYE and end connection
-                switch_to_error("Unsufficient lenght of message received");
-            // No reason for processing unsufficient-size response, repeat
-            continue;
+        // Sleep till datagram arrives or session ends, there is no periodic wakeup
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            OutputClass::out_err_intern("Error while waiting for data from server");
+            return;
         }
+        if (fds[1].revents != 0)
+            return;
+        // Take all already waiting datagrams
+        receive_pending();
+    }
+}
+/***********************************************************************************/
+void UDPClass::receive_pending () {
+    // Take all already waiting datagrams
+    while (this->stop_recv == false && receive_batch(MSG_DONTWAIT) == true);
+}
+/***********************************************************************************/
+bool UDPClass::receive_batch (int flags) {
+    for (size_t index = 0; index < this->batch_size; ++index) {
+        this->in_iovs[index] = {
+            .iov_base = this->in_buffers.data() + index * MAXLENGTH,
+            .iov_len  = MAXLENGTH
+        };
+        this->in_msgs[index] = {};
+        this->in_msgs[index].msg_hdr.msg_name    = &(this->in_addrs[index]);
+        this->in_msgs[index].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        this->in_msgs[index].msg_hdr.msg_iov     = &(this->in_iovs[index]);
+        this->in_msgs[index].msg_hdr.msg_iovlen  = 1;
+    }
+    int msgs_received = recvmmsg(this->socket_id, this->in_msgs.data(), this->batch_size, flags, nullptr);
+    MetricsClass::count(C_RECV_SYSCALLS);
 
-        // Store received data
-        UDP_DataStruct data;
-        // Load message header
-        std::memcpy(&data.header, in_buffer, sizeof(UDP_Header));
-        // Convert msg_id to correct indian
-        data.header.msg_id = htons(data.header.msg_id);
+    // Stop receiving when requested
+    if (this->stop_recv == true)
+        return false;
 
-        if (data.header.type == CONFIRM) { // Confirmation from server event
-            thread_event(CONFIRMATION, data.header.msg_id);
-            continue;
-        }
+    if (msgs_received <= 0) {
+        // Output error, timeout or no datagram waiting is not an error
+        if (errno != EWOULDBLOCK && errno != EAGAIN)
+            OutputClass::out_err_intern("Error while receiving data from server");
+        return false;
+    }
 
-        // Send confirmation to the server before processing received message
-        send_confirm(data.header.msg_id);
+    // Server may respond from different port, use the latest one
+    this->sock_str = this->in_addrs[msgs_received - 1];
 
-        if ((std::find(processed_msgs.begin(), processed_msgs.end(), data.header.msg_id)) != processed_msgs.end())
-            // Ignore and continue as already processed
+    this->in_datagrams.clear();
+    for (int index = 0; index < msgs_received; ++index)
+        this->in_datagrams.emplace_back(this->in_buffers.data() + index * MAXLENGTH, this->in_msgs[index].msg_len);
+    process_datagrams();
+    return true;
+}
+/***********************************************************************************/
+void UDPClass::process_datagrams () {
+    // Send confirmations of whole batch to the server before processing received messages
+    this->confirms.clear();
+    this->confirms_batch.clear();
+    for (std::string_view datagram : this->in_datagrams) {
+        if (datagram.size() < HEADER_SIZE || static_cast<uint8_t>(datagram[0]) == CONFIRM)
             continue;
 
-        // Store and mark as proceeded msg
-        processed_msgs.push_back(data.header.msg_id);
+        UDP_Header header;
+        std::memcpy(&header, datagram.data(), sizeof(UDP_Header));
+        MessageClass& confirm = this->confirms.emplace_back(CONFIRM);
+        confirm.ref_msg_id = htons(header.msg_id);
+        this->confirms_batch.push_back(&confirm);
+    }
+    if (this->confirms_batch.empty() == false)
+        send_confirms();
 
-        try {
-            deserialize_msg(data, in_buffer, bytes_received);
-        } catch (const std::logic_error& e) {
-            // Invalid message from server -> end connection
-            switch_to_error(e.what());
-            continue;
-        }
+    for (size_t index = 0; index < this->in_datagrams.size() && this->stop_recv == false; ++index)
+        process_msg(this->in_datagrams[index].data(), this->in_datagrams[index].size());
+}
+/***********************************************************************************/
+void UDPClass::send_confirms () {
+    // Ring has no room for whole batch (sends still running), send it right away
+    if (this->recv_ring.active() == false || this->free_confirms.size() < this->confirms_batch.size()) {
+        send_data_batch(this->confirms_batch);
+        return;
+    }
+    // Submitted without waiting, completions are taken together with next received datagrams
+    for (MessageClass* confirm : this->confirms_batch) {
+        uint32_t slot = this->free_confirms.back();
+        this->free_confirms.pop_back();
+        UringConfirm& out = this->uring_confirms[slot];
+        out.iov = {.iov_base = out.data, .iov_len = serialize_msg(*confirm, out.data)};
+        out.addr = this->sock_str;
+        out.header = {};
+        out.header.msg_name    = &out.addr;
+        out.header.msg_namelen = sizeof(out.addr);
+        out.header.msg_iov     = &out.iov;
+        out.header.msg_iovlen  = 1;
+        this->recv_ring.prepare_sendmsg(this->socket_id, &out.header, UringClass::tag(URING_SEND, slot));
+    }
+    MetricsClass::count(C_SEND_SYSCALLS);
+    if (this->recv_ring.submit(0) < 0) {
+        OutputClass::out_err_intern("Error while sending data to server");
+        return;
+    }
+    for (MessageClass* confirm : this->confirms_batch)
+        TraceClass::record(T_SEND, confirm->ref_msg_id, CONFIRM);
+    MetricsClass::count(C_MSGS_SENT, this->confirms_batch.size());
+}
+/***********************************************************************************/
+bool UDPClass::uring_receive () {
+    // Each provided buffer holds header of completed receive, sender address and whole datagram
+    if (this->recv_ring.init() == false ||
+        this->recv_ring.init_buffers(0, URING_BUFFERS, sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + MAXLENGTH) == false)
+        return false;
+    this->uring_confirms.resize(URING_ENTRIES / 2);
+    for (uint32_t slot = 0; slot < this->uring_confirms.size(); ++slot)
+        this->free_confirms.push_back(slot);
+    this->in_buffer_ids.reserve(this->batch_size);
+
+    // Kernel takes only sizes of address and control data from the header
+    this->uring_header = {};
+    this->uring_header.msg_namelen = sizeof(struct sockaddr_in);
+    this->recv_ring.prepare_recvmsg(this->socket_id, &this->uring_header, UringClass::tag(URING_RECV));
+    this->recv_ring.prepare_poll(this->stop_fd, UringClass::tag(URING_STOP));
+
+    struct sockaddr_in last_addr = this->sock_str;
+    bool received = false;
+    bool rearm = false;
+    // Processes collected datagrams and gives their buffers back to kernel
+    auto flush = [&] {
+        if (this->in_datagrams.empty() == true)
+            return;
+        // Server may respond from different port, use the latest one
+        this->sock_str = last_addr;
+        process_datagrams();
+        bool provided = true;
+        for (uint16_t buffer_id : this->in_buffer_ids)
+            provided = this->recv_ring.add_buffer(buffer_id) && provided;
+        if (this->recv_ring.publish_buffers() == false || provided == false)
+            OutputClass::out_err_intern("Error while giving receive buffers back to kernel");
+        this->in_datagrams.clear();
+        this->in_buffer_ids.clear();
+    };
 
-        // Process response
-        switch (this->cur_state) {
-            case S_AUTH:
-                switch (data.header.type) {
-                    case REPLY:
-                        // Replying to unexpected message id
-                        if ((std::find(to_reply_ids.begin(), to_reply_ids.end(), data.ref_msg_id)) == to_reply_ids.end()) {
-                            switch_to_error("Reply message has invalid ref_id");
-                            break;
-                        }
-                        // Output message
-                        OutputClass::out_reply(data.result, data.message);
-
-                        if (data.result == true) // Positive reply - switch to open
-                            this->cur_state = S_OPEN;
-                        // else: Negative reply -> stay in AUTH state and allow user to re-authenticate
-                        // Reset waiting for reply flag
-                        this->wait_for_reply = false;
-                        this->send_cond_var.notify_one();
-                        break;
-                    case ERR: // Output error and end
-                        OutputClass::out_err_server(data.display_name, data.message);
-                        send_priority_bye();
-                        break;
-                    default: // Transition to error state
-                        switch_to_error("Unexpected message received");
-                        break;
-                }
-                break;
-            case S_OPEN:
-                switch (data.header.type) {
-                    case REPLY:
-                        // Replying to unexpected message id
-                        if ((std::find(to_reply_ids.begin(), to_reply_ids.end(), data.ref_msg_id)) == to_reply_ids.end()) {
-                            switch_to_error("Reply message has invalid ref_id");
-                            break;
-                        }
-                        // Output server reply
-                        OutputClass::out_reply(data.result, data.message);
-                        // Reset waiting for reply flag
-                        this->wait_for_reply = false;
-                        this->send_cond_var.notify_one();
-                        break;
-                    case MSG: // Output message
-                        OutputClass::out_msg(data.display_name, data.message);
-                        break;
-                    case ERR: // Output error and send bye
-                        OutputClass::out_err_server(data.display_name, data.message);
-                        send_priority_bye();
-                        break;
-                    case BYE: // End connection
-                        session_end();
-                        return;
-                    default: // Transition to error state
-                        switch_to_error("Unexpected message received");
+    this->in_datagrams.clear();
+    while (this->stop_recv == false) {
+        // Multishot receive ended (no free buffer was left), start it again now that buffers were given back
+        if (rearm == true) {
+            this->recv_ring.prepare_recvmsg(this->socket_id, &this->uring_header, UringClass::tag(URING_RECV));
+            rearm = false;
+        }
+        // Sleep till datagram arrives or session ends, prepared operations are submitted by the same syscall
+        MetricsClass::count(C_RECV_SYSCALLS);
+        if (this->recv_ring.submit(1) < 0) {
+            OutputClass::out_err_intern("Error while waiting for data from server");
+            return true;
+        }
+        this->recv_ring.take_completions(this->recv_completions);
+        for (const UringCompletion& completion : this->recv_completions) {
+            switch (UringClass::kind(completion.user_data)) {
+                case URING_STOP:
+                    return true;
+                case URING_SEND:
+                    this->free_confirms.push_back(UringClass::slot(completion.user_data));
+                    if (completion.result < 0)
+                        OutputClass::out_err_intern("Error while sending data to server");
+                    break;
+                case URING_PROVIDE:
+                    OutputClass::out_err_intern("Error while giving receive buffers back to kernel");
+                    break;
+                case URING_RECV: {
+                    if ((completion.flags & IORING_CQE_F_MORE) == 0)
+                        rearm = true;
+                    if (completion.result < 0) {
+                        // Kernel without multishot receive, plain syscalls take over
+                        if (received == false && (completion.result == -EINVAL || completion.result == -EOPNOTSUPP))
+                            return false;
+                        if (completion.result != -ENOBUFS)
+                            OutputClass::out_err_intern("Error while receiving data from server");
                         break;
+                    }
+                    received = true;
+                    char* buffer = this->recv_ring.buffer(completion.flags);
+                    const struct io_uring_recvmsg_out* out = reinterpret_cast<struct io_uring_recvmsg_out*>(buffer);
+                    if (out->namelen >= sizeof(struct sockaddr_in))
+                        std::memcpy(&last_addr, buffer + sizeof(*out), sizeof(last_addr));
+                    // Longer datagram than buffer fits is cut like by recvmmsg
+                    size_t payload_size = std::min<size_t>(out->payloadlen, MAXLENGTH);
+                    this->in_datagrams.emplace_back(buffer + sizeof(*out) + this->uring_header.msg_namelen, payload_size);
+                    this->in_buffer_ids.push_back(UringClass::buffer_id(completion.flags));
+                    if (this->in_datagrams.size() >= this->batch_size)
+                        flush();
+                    break;
                 }
-                break;
-            case S_ERROR:
-            case S_START:
-            case S_END: // Ignore everything
-                break;
-            default: // Not expected state, output error
-                OutputClass::out_err_intern("Unknown current client state");
-                break;
+            }
+            if (this->stop_recv == true)
+                return true;
         }
+        flush();
+    }
+    return true;
+}
+/***********************************************************************************/
+void UDPClass::process_msg (const char* in_buffer, ssize_t bytes_received) {
+    if (bytes_received < HEADER_SIZE) { // 0 <= size < 3 -> send ERR, BYE and end connection
+        switch_to_error("Unsufficient lenght of message received");
+        return;
+    }
+
+    // Load message header
+    UDP_Header header;
+    std::memcpy(&header, in_buffer, sizeof(UDP_Header));
+    // Store received data, msg_id converted to correct indian
+    MessageClass data(header.type);
+    data.msg_id = htons(header.msg_id);
+    MetricsClass::count(C_MSGS_RECEIVED);
+
+    if (data.type == CONFIRM) { // Confirmation from server event
+        MetricsClass::count(C_CONFIRMS_RECEIVED);
+        if (this->use_threads == true)
+            thread_event(CONFIRMATION, data.msg_id);
+        else
+            confirm_received(data.msg_id);
+        return;
+    }
+
+    TraceClass::record(T_RECEIVE, data.msg_id, data.type);
+    // Check and mark as proceeded msg
+    if (this->processed_msgs.check_and_mark(data.msg_id) == true) {
+        // Ignore and continue as already processed
+        MetricsClass::count(C_DUPLICATES);
+        return;
+    }
+
+    try {
+        deserialize_msg(data, in_buffer, bytes_received);
+    } catch (const std::logic_error& e) {
+        // Invalid message from server -> end connection
+        switch_to_error(e.what());
+        return;
     }
+    TraceClass::record(T_DESERIALIZE, data.msg_id, data.type);
+
+    // Process response
+    handle_server_msg(data, data.msg_id);
 }
 /***********************************************************************************/
 void UDPClass::switch_to_error (std::string err_msg) {
     // Notify user
     OutputClass::out_err_intern(err_msg);
-    // Clear the queue
-    this->high_priority = true;
-    // Notify server
+    // Notify server, ERR jumps ahead of all queued messages
     send_err(err_msg);
-    // Then send BYE and end
-    send_bye();
+    // Then send BYE right after it and end
+    send_message(create_msg(BYE), true);
 }
 /***********************************************************************************/
-void UDPClass::get_msg_part (const char* input, size_t& input_pos, size_t max_size, std::string& store_to) {
-    for (size_t pos = 0; pos < max_size && input[pos] != '\0'; ++pos, ++input_pos)
-        store_to += input[pos];
+std::string_view UDPClass::get_msg_part (const char* input, size_t& input_pos, size_t total_size) {
+    if (input_pos >= total_size)
+        return std::string_view();
+    // Part ends with null byte or with the datagram
+    const char* part = input + input_pos;
+    const char* end = static_cast<const char*>(std::memchr(part, '\0', total_size - input_pos));
+    size_t part_size = (end != nullptr) ? static_cast<size_t>(end - part) : (total_size - input_pos);
     // Skip currently found null byte
-    ++input_pos;
+    input_pos += part_size + 1;
+    return std::string_view(part, part_size);
 }
 
-void UDPClass::deserialize_msg (UDP_DataStruct& out_str, const char* msg, size_t total_size) {
+void UDPClass::deserialize_msg (MessageClass& out_str, const char* msg, size_t total_size) {
     size_t msg_pos = sizeof(UDP_Header);
-    switch (out_str.header.type) {
+    switch (out_str.type) {
         case REPLY:
             if (total_size < 6) // Not enough for loading compulsory result (1B) + ref_msg_id (2B)
                 throw std::logic_error("Unsufficient lenght of REPLY message received");
             // Result
-            std::memcpy(&out_str.result, msg + msg_pos, sizeof(out_str.result));
-            msg_pos += sizeof(out_str.result);
+            out_str.result = (msg[msg_pos++] != 0);
             // Ref msg_id
             std::memcpy(&out_str.ref_msg_id, msg + msg_pos, sizeof(out_str.ref_msg_id));
             msg_pos += sizeof(out_str.ref_msg_id);
             // Message
-            get_msg_part(msg + msg_pos, msg_pos, (total_size - msg_pos), out_str.message);
+            out_str.set(P_MESSAGE, get_msg_part(msg, msg_pos, total_size));
             // Convert ref_msg_id to correct indian
             out_str.ref_msg_id = htons(out_str.ref_msg_id);
             break;
         case ERR:
         case MSG:
             // Display name
-            get_msg_part(msg + msg_pos, msg_pos, (total_size - msg_pos), out_str.display_name);
+            out_str.set(P_DISPLAY_NAME, get_msg_part(msg, msg_pos, total_size));
             // Message
-            get_msg_part(msg + msg_pos, msg_pos, (total_size - msg_pos), out_str.message);
+            out_str.set(P_MESSAGE, get_msg_part(msg, msg_pos, total_size));
             break;
         case BYE:
             break;
@@ -463,58 +953,65 @@ void UDPClass::deserialize_msg (UDP_DataStruct& out_str, const char* msg, size_t
             throw std::logic_error("Unknown message type provided");
     }
     // Check for msg integrity
-    if (check_valid_msg<UDP_DataStruct>(out_str.header.type, out_str) == false)
+    if (check_valid_msg(out_str) == false)
         throw std::logic_error("Invalid message provided");
 }
 /***********************************************************************************/
-std::string UDPClass::get_str_msg_id (uint16_t msg_id) {
-    std::string retval = "";
-    // Extract the individual bytes
-    char high_byte = static_cast<char>((msg_id >> 8) & 0xFF);
-    char low_byte  = static_cast<char>(msg_id & 0xFF);
-    // Append the bytes
-    retval += high_byte;
-    retval += low_byte;
-    // Return constructed string holding correct value of msg_id
-    return retval;
+void UDPClass::put_msg_id (char* output, size_t& output_pos, uint16_t msg_id) {
+    // Store the individual bytes in network order
+    output[output_pos++] = static_cast<char>((msg_id >> 8) & 0xFF);
+    output[output_pos++] = static_cast<char>(msg_id & 0xFF);
+}
+
+void UDPClass::put_msg_part (char* output, size_t& output_pos, std::string_view part) {
+    std::memcpy(output + output_pos, part.data(), part.size());
+    output_pos += part.size();
+    // Terminate with null byte
+    output[output_pos++] = '\0';
 }
 /***********************************************************************************/
-std::string UDPClass::convert_to_string (UDP_DataStruct& data) {
-    std::string msg(1, static_cast<char>(data.header.type));
-    switch (data.header.type) {
+size_t UDPClass::serialize_msg (MessageClass& data, char* out_buffer) {
+    // Message values are validated before sending, so composed message always fits into MAXLENGTH
+    size_t msg_pos = 0;
+    out_buffer[msg_pos++] = static_cast<char>(data.type);
+    switch (data.type) {
         case CONFIRM:
-            msg += get_str_msg_id(data.ref_msg_id);
+            put_msg_id(out_buffer, msg_pos, data.ref_msg_id);
             break;
         case AUTH:
-            msg += get_str_msg_id(data.header.msg_id) + data.user_name + '\0' + data.display_name + '\0' + data.secret + '\0';
+            put_msg_id(out_buffer, msg_pos, data.msg_id);
+            put_msg_part(out_buffer, msg_pos, data.user_name());
+            put_msg_part(out_buffer, msg_pos, data.display_name());
+            put_msg_part(out_buffer, msg_pos, data.secret());
             break;
         case JOIN:
-            msg += get_str_msg_id(data.header.msg_id) + data.channel_id + '\0' + data.display_name + '\0';
+            put_msg_id(out_buffer, msg_pos, data.msg_id);
+            put_msg_part(out_buffer, msg_pos, data.channel_id());
+            put_msg_part(out_buffer, msg_pos, data.display_name());
             break;
         case MSG:
-            msg += get_str_msg_id(data.header.msg_id) + data.display_name + '\0' + data.message + '\0';
-            break;
         case ERR:
-            msg += get_str_msg_id(data.header.msg_id) + data.display_name + '\0' + data.message + '\0';
+            put_msg_id(out_buffer, msg_pos, data.msg_id);
+            put_msg_part(out_buffer, msg_pos, data.display_name());
+            put_msg_part(out_buffer, msg_pos, data.message());
             break;
         case BYE:
-            msg += get_str_msg_id(data.header.msg_id);
+            put_msg_id(out_buffer, msg_pos, data.msg_id);
             break;
         default: // Shouldn't happen as type is not user-provided
             break;
     }
-    // Return composed message
+    // Return size of composed message
+    return msg_pos;
+}
+/***********************************************************************************/
+MessageClass* UDPClass::create_msg (uint8_t type) {
+    // Take message from session pool and give it next msg_id
+    MessageClass* msg = this->pool.acquire(type);
+    msg->msg_id = create_msg_id();
     return msg;
 }
 /***********************************************************************************/
-UDP_Header UDPClass::create_header (uint8_t type) {
-    // Create header for requested message
-    UDP_Header header = (UDP_Header){
-        .type   = type,
-        .msg_id = this->msg_id
-    };
-    // Avoid useless msg_id incrementation when sending CONFIRM
-    if (type != CONFIRM)
-        ++(this->msg_id);
-    return header;
+uint16_t UDPClass::create_msg_id () {
+    return this->msg_id++;
 }
@@ -4,6 +4,10 @@
 #define HEADER_SIZE 3
 
 #include "ClientClass.h"
+#include "TimerClass.h"
+#include "RTTClass.h"
+#include "DupFilterClass.h"
+#include "SendQueueClass.h"
 
 #pragma pack(push, 1)
 typedef struct {
@@ -12,64 +16,147 @@ typedef struct {
 } UDP_Header;
 #pragma pack(pop)
 
+// CONFIRM sent through io_uring, everything kernel reads has to stay valid till the send completes
 typedef struct {
-    UDP_Header header;                  // 3 bytes (msg_type + msg_id)
-    uint16_t ref_msg_id      = 0;       // 2 bytes
-    bool result              = false;   // 1 byte
-    std::string message      = "";      // N bytes
-    std::string user_name    = "";      // N bytes
-    std::string display_name = "";      // N bytes
-    std::string secret       = "";      // N bytes
-    std::string channel_id   = "";      // N bytes
-    bool sent                = false;   // 1 bytes
-} UDP_DataStruct;
+    char data[HEADER_SIZE];
+    struct iovec iov;
+    struct msghdr header;
+    struct sockaddr_in addr;
+} UringConfirm;
 
 class UDPClass : public ClientClass {
+    // Codec microbenchmarks (make bench) measure private serialization methods
+    friend class CodecBenchClass;
+
     private:
         // Transport data
         std::atomic<uint16_t> msg_id;
         uint8_t recon_attempts;
         uint16_t timeout;
+        // Max number of messages being on the wire at once waiting for CONFIRM
+        uint16_t window_size;
+        // Max number of datagrams sent/received with single syscall
+        uint16_t batch_size;
 
         struct sockaddr_in sock_str;
 
-        std::mutex send_mutex;
+        // Filter of msg_ids already received
+        DupFilterClass processed_msgs;
+        // Msg_ids of sent AUTH/JOIN msgs still waiting for REPLY, possible values of its ref_msg_id
+        std::unordered_set<uint16_t> pending_replies;
+
+        // Buffers for batch of received datagrams and their confirmations
+        std::vector<char> in_buffers;
+        std::vector<struct iovec> in_iovs;
+        std::vector<struct mmsghdr> in_msgs;
+        std::vector<struct sockaddr_in> in_addrs;
+        // Datagrams of batch being processed, point into in_buffers or buffers of recv_ring
+        std::vector<std::string_view> in_datagrams;
+        std::vector<MessageClass> confirms;
+        std::vector<MessageClass*> confirms_batch;
+        // Msgs to be sent to server with single syscall
+        std::vector<MessageClass*> batch;
+        // Receive thread io_uring state - multishot receive header, CONFIRMs being sent and buffers of processed datagrams
+        struct msghdr uring_header;
+        std::vector<UringConfirm> uring_confirms;
+        std::vector<uint32_t> free_confirms;
+        std::vector<uint16_t> in_buffer_ids;
+
+        // Messages already sent to server and waiting for CONFIRM, there is at most window of them
+        std::vector<MessageClass*> in_flight;
+        // Retransmission deadlines of in-flight messages and REPLY deadline of confirmed AUTH/JOIN
+        TimerClass timers;
+        // Msg_ids of deadlines expired at last check, reused so sending thread doesnt allocate
+        std::vector<uint16_t> expired_ids;
+        // Earlier msg_ids of resent messages mapped to msg_id they are in flight under now
+        std::unordered_map<uint16_t, uint16_t> resent_ids;
+        // Other msg_ids of messages already confirmed by one of their copies, CONFIRM may still come for them
+        std::bitset<0x10000> superseded_ids;
+        // Retransmission timeout estimated from CONFIRM round trip times
+        RTTClass rtt;
+
+        // Suspends delivery coroutine of event loop engine till message sent under given msg_id is confirmed,
+        // evaluates to false once timeout expired first
+        struct ConfirmAwaiter {
+            UDPClass* client;
+            uint16_t msg_id;
+            std::chrono::microseconds timeout;
+            std::coroutine_handle<> handle;
+            bool confirmed;
 
-        // Vector to store all msg_ids already received
-        std::vector<uint16_t> processed_msgs;
-        // Vector to store all sent msgs and possible reply values in ref_msg_id
-        std::vector<uint16_t> to_reply_ids;
+            bool await_ready () noexcept {
+                return false;
+            }
+            void await_suspend (std::coroutine_handle<> handle) noexcept {
+                this->handle = handle;
+                this->client->confirm_waits.push_back(this);
+                this->client->timers.arm(this->msg_id, TimerClass::clock::now() + this->timeout);
+            }
+            bool await_resume () noexcept {
+                return this->confirmed;
+            }
+        };
+        // Delivery coroutines waiting for CONFIRM, at most one for each message in flight
+        std::vector<ConfirmAwaiter*> confirm_waits;
 
-        std::queue<std::pair<UDP_DataStruct, uint>> messages_to_send;
+        ConfirmAwaiter confirm (uint16_t sent_id, std::chrono::microseconds timeout) {
+            return {this, sent_id, timeout, nullptr, false};
+        }
+        SessionTaskClass deliver (MessageClass* to_send) override;
+        void confirm_received (uint16_t event_msg_id);
+        bool wake_confirm (uint16_t sent_id, bool confirmed);
 
-        void send_message (UDP_DataStruct data);
-        void send_data (UDP_DataStruct& data);
+        bool send_message (MessageClass* data, bool priority = false);
+        void send_data (MessageClass& data);
         void send_err (std::string err_msg);
-        void send_confirm (uint16_t confirm_to_id);
+        void send_data_batch (std::vector<MessageClass*>& batch, UringClass* ring = nullptr);
+        void flush_batch ();
+        void send_window ();
+        bool receive_batch (int flags);
+        void process_datagrams ();
+        void send_confirms ();
+        bool uring_receive ();
+        void process_msg (const char* in_buffer, ssize_t bytes_received);
         void handle_send ();    // Thread for sending data to the server
         void handle_receive (); // Thread for receiving messages from server
         /* Helper methods */
-        void set_socket_timeout (uint16_t timeout);
-        void deserialize_msg (UDP_DataStruct& out_str, const char* msg, size_t total_size);
-        void get_msg_part (const char* input, size_t& input_pos, size_t max_size, std::string& store_to);
-        void switch_to_error (std::string err_msg);
-        void thread_event (THREAD_EVENT event, uint16_t confirm_to_id = 0);
-        std::string convert_to_string (UDP_DataStruct& data);
-        std::string get_str_msg_id (uint16_t msg_id);
-        UDP_Header create_header (uint8_t type);
+        void deserialize_msg (MessageClass& out_str, const char* msg, size_t total_size);
+        std::string_view get_msg_part (const char* input, size_t& input_pos, size_t total_size);
+        void switch_to_error (std::string err_msg) override;
+        void thread_event (THREAD_EVENT event, uint16_t event_msg_id = 0);
+        bool can_send_next ();
+        std::vector<MessageClass*>::iterator find_in_flight (uint16_t sent_id);
+        void abandon_sent () override;
+        void forget_copies (uint16_t confirmed_id, uint16_t event_msg_id);
+        bool blocks_window (uint8_t type);
+        bool window_open (uint8_t msg_type) override;
+        void resend (MessageClass* to_resend);
+        void update_load_input ();
+        void expect_reply (uint16_t sent_id, uint8_t type);
+        bool reply_expected (uint16_t ref_msg_id) override;
+        void reply_finished () override;
+        std::chrono::milliseconds reply_timeout () override;
+        size_t serialize_msg (MessageClass& data, char* out_buffer);
+        void put_msg_id (char* output, size_t& output_pos, uint16_t msg_id);
+        void put_msg_part (char* output, size_t& output_pos, std::string_view part);
+        MessageClass* create_msg (uint8_t type);
+        uint16_t create_msg_id ();
 
     public:
         UDPClass (std::map<std::string, std::string> data_map);
         ~UDPClass () {};
         // Inherited methods from parent ClientClass class
         void open_connection () override;
-        void send_auth (std::string user_name, std::string display_name, std::string secret) override;
-        void send_msg (std::string msg) override;
-        void send_join (std::string channel_id) override;
+        bool send_auth (std::string_view user_name, std::string_view display_name, std::string_view secret) override;
+        bool send_msg (std::string_view msg) override;
+        bool send_join (std::string_view channel_id) override;
         void send_bye () override;
         void send_priority_bye () override;
         void session_end () override;
         bool send_rename (std::string new_display_name) override;
+        void send_pending () override;
+        void receive_pending () override;
+        bool next_deadline (std::chrono::steady_clock::time_point& deadline) override;
     };
 
 #endif // UDPCLASS_H
\ No newline at end of file
@@ -0,0 +1,359 @@
+#ifndef URINGCLASS_H
+#define URINGCLASS_H
+
+#include "ConstsFile.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Submission queue entries of single ring, completion queue is twice as long
+#define URING_ENTRIES 256
+// Provided buffers of receiving ring
+#define URING_BUFFERS 256
+
+// Kinds of submitted operations, stored in low byte of user_data, rest holds slot index
+enum URING_TAG : uint8_t {
+    URING_RECV = 1, // Multishot receive, completes once per datagram or chunk of stream
+    URING_STOP,     // Poll of stop event, session ended
+    URING_SEND,     // Send of single message
+    URING_PROVIDE   // Provision of returned buffers without buffer ring, completes only on failure
+};
+
+// Copy of completion, queue slot is reused as soon as it is consumed
+typedef struct {
+    uint64_t user_data;
+    int32_t result;
+    uint32_t flags;
+} UringCompletion;
+
+// Minimal io_uring ring driven by raw syscalls, owned by single thread which has to create it too.
+// Received data lands in provided buffers, kernel picks a free one for every completion. Buffers are given
+// to kernel through mapped buffer ring, provision operations are used only when it cant be registered
+class UringClass {
+    public:
+        UringClass ()
+        : ring_fd        (-1),
+          ring_memory    (MAP_FAILED),
+          ring_size      (0),
+          sq_entries     (0),
+          sqes           (nullptr),
+          sq_tail_local  (0),
+          sq_submitted   (0),
+          buffers_size     (0),
+          buffers_group    (0),
+          buffers_provided (false),
+          pending_first    (0),
+          pending_count    (0),
+          buf_ring         (nullptr),
+          buf_ring_size    (0),
+          buf_ring_tail    (0),
+          buf_ring_mask    (0)
+        {
+        }
+        ~UringClass () {
+            // Closing ring cancels operations still running, buffers are unmapped after that
+            if (this->ring_fd >= 0)
+                close(this->ring_fd);
+            if (this->ring_memory != MAP_FAILED)
+                munmap(this->ring_memory, this->ring_size);
+            if (this->sqes != nullptr)
+                munmap(this->sqes, this->sq_entries * sizeof(struct io_uring_sqe));
+            if (this->buf_ring != nullptr)
+                munmap(this->buf_ring, this->buf_ring_size);
+        }
+
+        // Creates ring for calling thread, false if kernel doesnt support (or allow) io_uring
+        bool init (unsigned entries = URING_ENTRIES) {
+            struct io_uring_params params = {};
+            // Completions are processed only when owner waits for them, no interrupts of running thread
+            params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+            this->ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (this->ring_fd < 0 && errno == EINVAL) {
+                // Older kernel without these flags
+                params = {};
+                this->ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            }
+            if (this->ring_fd < 0)
+                return false;
+            // Both queues in single mapping (5.4+), kernel without it is too old for multishot receive anyway
+            if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0)
+                return fail();
+
+            this->sq_entries = params.sq_entries;
+            this->ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                       params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+            this->ring_memory = mmap(nullptr, this->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     this->ring_fd, IORING_OFF_SQ_RING);
+            if (this->ring_memory == MAP_FAILED)
+                return fail();
+            void* sqes_memory = mmap(nullptr, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES);
+            if (sqes_memory == MAP_FAILED)
+                return fail();
+            this->sqes = static_cast<struct io_uring_sqe*>(sqes_memory);
+
+            char* memory = static_cast<char*>(this->ring_memory);
+            this->sq_head = reinterpret_cast<unsigned*>(memory + params.sq_off.head);
+            this->sq_tail = reinterpret_cast<unsigned*>(memory + params.sq_off.tail);
+            this->sq_mask = *reinterpret_cast<unsigned*>(memory + params.sq_off.ring_mask);
+            this->cq_head = reinterpret_cast<unsigned*>(memory + params.cq_off.head);
+            this->cq_tail = reinterpret_cast<unsigned*>(memory + params.cq_off.tail);
+            this->cq_mask = *reinterpret_cast<unsigned*>(memory + params.cq_off.ring_mask);
+            this->cqes = reinterpret_cast<struct io_uring_cqe*>(memory + params.cq_off.cqes);
+            // Entries are always submitted in order, index array maps each slot to itself
+            unsigned* sq_array = reinterpret_cast<unsigned*>(memory + params.sq_off.array);
+            for (unsigned index = 0; index < params.sq_entries; ++index)
+                sq_array[index] = index;
+            this->sq_tail_local = *this->sq_tail;
+            this->sq_submitted = this->sq_tail_local;
+            return true;
+        }
+        // Returns value indicating whether ring was created
+        bool active () {
+            return this->ring_fd >= 0;
+        }
+        // Provides count buffers of given size kernel fills received data into, false if not supported
+        bool init_buffers (uint16_t group, uint16_t count, uint32_t size) {
+            this->buffers_size = size;
+            this->buffers_group = group;
+            this->buffers.resize(static_cast<size_t>(count) * size);
+            if (register_buf_ring(count) == true) {
+                for (uint16_t buffer_id = 0; buffer_id < count; ++buffer_id)
+                    add_buffer(buffer_id);
+                return publish_buffers();
+            }
+            for (uint16_t buffer_id = 0; buffer_id < count; ++buffer_id)
+                add_buffer(buffer_id);
+            if (publish_buffers() == false || submit(1) < 0)
+                return false;
+            std::vector<UringCompletion> completions;
+            take_completions(completions);
+            return completions.empty() == false && completions[0].result >= 0;
+        }
+        // Returns received data of buffer given by completion flags
+        char* buffer (uint32_t flags) {
+            return this->buffers.data() + static_cast<size_t>(buffer_id(flags)) * this->buffers_size;
+        }
+        static uint16_t buffer_id (uint32_t flags) {
+            return static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+        // Gives buffer back to kernel once its data was processed, kernel sees returned ones after publish_buffers.
+        // Without buffer ring, buffers returned in order of their ids are provided by single operation.
+        // False if earlier range couldnt be provided
+        bool add_buffer (uint16_t buffer_id) {
+            if (this->buf_ring != nullptr) {
+                // Fields are written one by one, reserved field of the first entry holds the ring tail
+                struct io_uring_buf& entry = this->buf_ring[this->buf_ring_tail & this->buf_ring_mask];
+                entry.addr = reinterpret_cast<uint64_t>(this->buffers.data() + static_cast<size_t>(buffer_id) * this->buffers_size);
+                entry.len = this->buffers_size;
+                entry.bid = buffer_id;
+                ++this->buf_ring_tail;
+                return true;
+            }
+            bool provided = true;
+            if (this->pending_count > 0 && this->pending_first + this->pending_count != buffer_id)
+                provided = publish_buffers();
+            // Failed range was dropped, so new one always starts here
+            if (this->pending_count == 0)
+                this->pending_first = buffer_id;
+            ++this->pending_count;
+            return provided;
+        }
+        // False if ring couldnt take the operation, pending buffers are dropped then and kernel doesnt get them back
+        bool publish_buffers () {
+            if (this->buf_ring != nullptr) {
+                // Entries written before are visible to kernel once it sees the new tail
+                struct io_uring_buf_ring* ring = reinterpret_cast<struct io_uring_buf_ring*>(this->buf_ring);
+                std::atomic_ref<uint16_t>(ring->tail).store(this->buf_ring_tail, std::memory_order_release);
+                return true;
+            }
+            if (this->pending_count == 0)
+                return true;
+            // Provision operation (5.7+) is needed only on kernels without buffer rings (5.19+)
+            struct io_uring_sqe* sqe = prepare(IORING_OP_PROVIDE_BUFFERS, this->pending_count, tag(URING_PROVIDE));
+            if (sqe == nullptr) {
+                this->pending_count = 0;
+                return false;
+            }
+            sqe->addr = reinterpret_cast<uint64_t>(this->buffers.data() + static_cast<size_t>(this->pending_first) * this->buffers_size);
+            sqe->len = this->buffers_size;
+            sqe->off = this->pending_first;
+            sqe->buf_group = this->buffers_group;
+            // Only failure is reported, once ring is set up
+            if (this->buffers_provided == true)
+                sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+            this->buffers_provided = true;
+            this->pending_count = 0;
+            return true;
+        }
+
+        // Multishot receive of stream into provided buffers
+        bool prepare_recv (int fd, uint64_t user_data) {
+            struct io_uring_sqe* sqe = prepare(IORING_OP_RECV, fd, user_data);
+            if (sqe == nullptr)
+                return false;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = this->buffers_group;
+            return true;
+        }
+        // Multishot receive of datagrams into provided buffers, header tells only sizes of name and control data.
+        // Buffer starts with io_uring_recvmsg_out, name and payload follow
+        bool prepare_recvmsg (int fd, struct msghdr* header, uint64_t user_data) {
+            struct io_uring_sqe* sqe = prepare(IORING_OP_RECVMSG, fd, user_data);
+            if (sqe == nullptr)
+                return false;
+            sqe->addr = reinterpret_cast<uint64_t>(header);
+            sqe->len = 0;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = this->buffers_group;
+            return true;
+        }
+        bool prepare_poll (int fd, uint64_t user_data) {
+            struct io_uring_sqe* sqe = prepare(IORING_OP_POLL_ADD, fd, user_data);
+            if (sqe == nullptr)
+                return false;
+            sqe->poll32_events = POLLIN;
+            return true;
+        }
+        // Linked send starts only once previous one completed, so stream keeps order of messages
+        bool prepare_send (int fd, const char* data, size_t size, uint64_t user_data, bool linked) {
+            struct io_uring_sqe* sqe = prepare(IORING_OP_SEND, fd, user_data);
+            if (sqe == nullptr)
+                return false;
+            sqe->addr = reinterpret_cast<uint64_t>(data);
+            sqe->len = static_cast<uint32_t>(size);
+            // Short send would break the chain, kernel retries till everything is sent
+            sqe->msg_flags = MSG_WAITALL;
+            sqe->flags = (linked == true) ? IOSQE_IO_LINK : 0;
+            return true;
+        }
+        bool prepare_sendmsg (int fd, const struct msghdr* header, uint64_t user_data) {
+            struct io_uring_sqe* sqe = prepare(IORING_OP_SENDMSG, fd, user_data);
+            if (sqe == nullptr)
+                return false;
+            sqe->addr = reinterpret_cast<uint64_t>(header);
+            sqe->len = 1;
+            return true;
+        }
+
+        // Submits prepared operations and waits till at least wait_count completions are ready, all with one syscall
+        int submit (unsigned wait_count) {
+            std::atomic_ref<unsigned>(*this->sq_tail).store(this->sq_tail_local, std::memory_order_release);
+            unsigned to_submit = this->sq_tail_local - this->sq_submitted;
+            while (true) {
+                int result = static_cast<int>(syscall(__NR_io_uring_enter, this->ring_fd, to_submit, wait_count,
+                                                      (wait_count > 0) ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+                if (result >= 0) {
+                    this->sq_submitted += result;
+                    return result;
+                }
+                // Interrupted wait already submitted everything
+                if (errno == EINTR) {
+                    this->sq_submitted = this->sq_tail_local;
+                    to_submit = 0;
+                    continue;
+                }
+                return -errno;
+            }
+        }
+        // Moves all ready completions to given vector, queue slots are free right after
+        void take_completions (std::vector<UringCompletion>& completions) {
+            completions.clear();
+            unsigned head = *this->cq_head;
+            unsigned tail = std::atomic_ref<unsigned>(*this->cq_tail).load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                const struct io_uring_cqe& cqe = this->cqes[head & this->cq_mask];
+                completions.push_back({cqe.user_data, cqe.res, cqe.flags});
+            }
+            std::atomic_ref<unsigned>(*this->cq_head).store(head, std::memory_order_release);
+        }
+        static uint64_t tag (URING_TAG kind, uint32_t slot = 0) {
+            return kind | (static_cast<uint64_t>(slot) << 8);
+        }
+        static URING_TAG kind (uint64_t user_data) {
+            return static_cast<URING_TAG>(user_data & 0xFF);
+        }
+        static uint32_t slot (uint64_t user_data) {
+            return static_cast<uint32_t>(user_data >> 8);
+        }
+
+    private:
+        int ring_fd;
+        void* ring_memory;
+        size_t ring_size;
+        unsigned sq_entries;
+        unsigned* sq_head;
+        unsigned* sq_tail;
+        unsigned sq_mask;
+        unsigned* cq_head;
+        unsigned* cq_tail;
+        unsigned cq_mask;
+        struct io_uring_sqe* sqes;
+        struct io_uring_cqe* cqes;
+        // Entries prepared by owner, kernel sees them once submitted
+        unsigned sq_tail_local;
+        unsigned sq_submitted;
+
+        std::vector<char> buffers;
+        uint32_t buffers_size;
+        uint16_t buffers_group;
+        bool buffers_provided;
+        // Returned buffers not provided yet
+        uint16_t pending_first;
+        uint16_t pending_count;
+        // Buffer ring shared with kernel, owner fills entries past the tail and publishes it. Entries are indexed
+        // directly, bufs member of io_uring_buf_ring starts after an empty struct, which takes a byte in C++
+        struct io_uring_buf* buf_ring;
+        size_t buf_ring_size;
+        uint16_t buf_ring_tail;
+        uint16_t buf_ring_mask;
+
+        bool fail () {
+            close(this->ring_fd);
+            this->ring_fd = -1;
+            return false;
+        }
+        // Registers ring of count (power of two) entries for buffer group, false if kernel doesnt support it
+        bool register_buf_ring (uint16_t count) {
+            if (count == 0 || (count & (count - 1)) != 0)
+                return false;
+            this->buf_ring_size = static_cast<size_t>(count) * sizeof(struct io_uring_buf);
+            void* memory = mmap(nullptr, this->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+            if (memory == MAP_FAILED)
+                return false;
+
+            struct io_uring_buf_reg reg = {};
+            reg.ring_addr = reinterpret_cast<uint64_t>(memory);
+            reg.ring_entries = count;
+            reg.bgid = this->buffers_group;
+            if (syscall(__NR_io_uring_register, this->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+                munmap(memory, this->buf_ring_size);
+                return false;
+            }
+            this->buf_ring = static_cast<struct io_uring_buf*>(memory);
+            this->buf_ring_mask = count - 1;
+            this->buf_ring_tail = 0;
+            return true;
+        }
+        // Takes next free submission entry, queue full of prepared ones is submitted first
+        struct io_uring_sqe* prepare (uint8_t opcode, int fd, uint64_t user_data) {
+            if (this->sq_tail_local - std::atomic_ref<unsigned>(*this->sq_head).load(std::memory_order_acquire) >= this->sq_entries) {
+                if (submit(0) < 0)
+                    return nullptr;
+                if (this->sq_tail_local - std::atomic_ref<unsigned>(*this->sq_head).load(std::memory_order_acquire) >= this->sq_entries)
+                    return nullptr;
+            }
+            struct io_uring_sqe* sqe = &this->sqes[this->sq_tail_local & this->sq_mask];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = opcode;
+            sqe->fd = fd;
+            sqe->user_data = user_data;
+            ++this->sq_tail_local;
+            return sqe;
+        }
+};
+
+#endif // URINGCLASS_H
\ No newline at end of file
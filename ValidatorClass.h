@@ -0,0 +1,130 @@
+#ifndef VALIDATORCLASS_H
+#define VALIDATORCLASS_H
+
+#include "ConstsFile.h"
+
+#include <array>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Inclusive range of accepted bytes
+typedef struct {
+    uint8_t low;
+    uint8_t high;
+} ByteRange;
+
+// Checks message field values against protocol grammar - allowed characters and length limits.
+// Bytes are checked in 16 (SSE2) or 32 (AVX2, when supported by CPU) byte blocks, rest of field by scalar loop
+class ValidatorClass {
+    public:
+        // [A-Za-z0-9-] (with [\]^_` between the letters), max 20 chars
+        static bool user_name (std::string_view value) {
+            return check_field(value, 20, ID_CHARS);
+        }
+        // [A-Za-z0-9-.] (with [\]^_` between the letters), max 20 chars
+        static bool channel_id (std::string_view value) {
+            return check_field(value, 20, CHANNEL_CHARS);
+        }
+        // [A-Za-z0-9-] (with [\]^_` between the letters), max 128 chars
+        static bool secret (std::string_view value) {
+            return check_field(value, 128, ID_CHARS);
+        }
+        // Printable characters without space, max 20 chars
+        static bool display_name (std::string_view value) {
+            return check_field(value, 20, VISIBLE_CHARS);
+        }
+        // Printable characters including space, max 1400 chars
+        static bool message (std::string_view value) {
+            return check_field(value, 1400, PRINTABLE_CHARS);
+        }
+
+    private:
+        static constexpr std::array<ByteRange, 3> ID_CHARS        = {{{0x2D, 0x2D}, {0x30, 0x39}, {0x41, 0x7A}}};
+        static constexpr std::array<ByteRange, 3> CHANNEL_CHARS   = {{{0x2D, 0x2E}, {0x30, 0x39}, {0x41, 0x7A}}};
+        static constexpr std::array<ByteRange, 1> VISIBLE_CHARS   = {{{0x21, 0x7E}}};
+        static constexpr std::array<ByteRange, 1> PRINTABLE_CHARS = {{{0x20, 0x7E}}};
+
+        template <size_t N>
+        static bool check_field (std::string_view value, size_t max_length, const std::array<ByteRange, N>& ranges) {
+            if (value.empty() == true || value.size() > max_length)
+                return false;
+
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(value.data());
+            size_t checked = 0;
+#if defined(__x86_64__) || defined(__i386__)
+            if (value.size() >= 32 && has_avx2() == true) {
+                if ((checked = check_blocks_avx2(data, value.size(), ranges)) == SIZE_MAX)
+                    return false;
+            }
+            size_t sse2_checked = check_blocks_sse2(data + checked, value.size() - checked, ranges);
+            if (sse2_checked == SIZE_MAX)
+                return false;
+            checked += sse2_checked;
+#endif
+            for (; checked < value.size(); ++checked) {
+                if (in_ranges(data[checked], ranges) == false)
+                    return false;
+            }
+            return true;
+        }
+
+        template <size_t N>
+        static bool in_ranges (uint8_t byte, const std::array<ByteRange, N>& ranges) {
+            for (const ByteRange& range : ranges) {
+                // Byte below low wraps around to big number
+                if (static_cast<uint8_t>(byte - range.low) <= range.high - range.low)
+                    return true;
+            }
+            return false;
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        static bool has_avx2 () {
+            static const bool supported = __builtin_cpu_supports("avx2");
+            return supported;
+        }
+
+        // Returns number of checked bytes (whole blocks only), SIZE_MAX if invalid byte was found
+        template <size_t N>
+        __attribute__((target("sse2")))
+        static size_t check_blocks_sse2 (const uint8_t* data, size_t size, const std::array<ByteRange, N>& ranges) {
+            size_t pos = 0;
+            for (; pos + 16 <= size; pos += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                __m128i valid = _mm_setzero_si128();
+                for (const ByteRange& range : ranges) {
+                    // Same wraparound trick as scalar check, unsigned compare done by min
+                    __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8(static_cast<char>(range.low)));
+                    __m128i limited = _mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(range.high - range.low)));
+                    valid = _mm_or_si128(valid, _mm_cmpeq_epi8(shifted, limited));
+                }
+                if (_mm_movemask_epi8(valid) != 0xFFFF)
+                    return SIZE_MAX;
+            }
+            return pos;
+        }
+
+        template <size_t N>
+        __attribute__((target("avx2")))
+        static size_t check_blocks_avx2 (const uint8_t* data, size_t size, const std::array<ByteRange, N>& ranges) {
+            size_t pos = 0;
+            for (; pos + 32 <= size; pos += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+                __m256i valid = _mm256_setzero_si256();
+                for (const ByteRange& range : ranges) {
+                    __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8(static_cast<char>(range.low)));
+                    __m256i limited = _mm256_min_epu8(shifted, _mm256_set1_epi8(static_cast<char>(range.high - range.low)));
+                    valid = _mm256_or_si256(valid, _mm256_cmpeq_epi8(shifted, limited));
+                }
+                if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xFFFFFFFF)
+                    return SIZE_MAX;
+            }
+            return pos;
+        }
+#endif
+};
+
+#endif // VALIDATORCLASS_H
\ No newline at end of file
@@ -0,0 +1,165 @@
+#ifndef WRITERCLASS_H
+#define WRITERCLASS_H
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <climits>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "MPSCQueueClass.h"
+#include "TraceClass.h"
+
+// When queued output lines are written
+enum FLUSH_POLICY : uint8_t {
+    F_LINE = 0, // As soon as writer gets to them
+    F_TIME,     // Given number of milliseconds after first unwritten line
+    F_SIZE      // Once given number of bytes is waiting (or at exit)
+};
+
+// Writes output lines on its own thread, so slow stdout/stderr reader cant stall the client threads.
+// Lines of both descriptors go through single bounded lock-free queue to keep their order,
+// writer then writes consecutive lines of the same descriptor by single writev
+class WriterClass {
+    public:
+        // Writer is created by first output and flushed at program exit
+        static WriterClass& instance () {
+            static WriterClass writer;
+            return writer;
+        }
+
+        void set_policy (FLUSH_POLICY policy, size_t value) {
+            this->policy_value.store(value);
+            this->policy.store(policy);
+        }
+        // Queues line (including its "\n") to be written into given descriptor
+        void push (int fd, std::string&& line) {
+            this->queue.push({fd, std::move(line)});
+            // Wake up writer
+            this->pushed.fetch_add(1, std::memory_order_release);
+            this->pushed.notify_one();
+        }
+
+    private:
+        WriterClass ()
+        : policy       (F_LINE),
+          policy_value (0),
+          pushed       (0),
+          stopping     (false),
+          pending_size (0)
+        {
+            this->writer = std::thread(&WriterClass::run, this);
+        }
+        ~WriterClass () {
+            // Writer writes out everything queued before it ends
+            this->stopping.store(true, std::memory_order_release);
+            this->pushed.fetch_add(1, std::memory_order_release);
+            this->pushed.notify_one();
+            this->writer.join();
+        }
+
+        void run () {
+            TraceClass::set_thread_name("writer");
+            std::chrono::steady_clock::time_point first_pending;
+            while (true) {
+                uint32_t seen = this->pushed.load(std::memory_order_acquire);
+                bool stop = this->stopping.load(std::memory_order_acquire);
+
+                bool was_empty = this->pending.empty();
+                while (pop() == true);
+                if (was_empty == true && this->pending.empty() == false)
+                    first_pending = std::chrono::steady_clock::now();
+
+                if (this->pending.empty() == false) {
+                    size_t value = this->policy_value.load();
+                    switch (this->policy.load()) {
+                        case F_TIME: {
+                            auto deadline = first_pending + std::chrono::milliseconds(value);
+                            if (stop == false && std::chrono::steady_clock::now() < deadline) {
+                                // Let more lines come till deadline
+                                std::this_thread::sleep_until(deadline);
+                                continue;
+                            }
+                            write_pending();
+                            break;
+                        }
+                        case F_SIZE:
+                            if (stop == true || this->pending_size >= value)
+                                write_pending();
+                            break;
+                        default:
+                            write_pending();
+                            break;
+                    }
+                }
+
+                if (stop == true)
+                    break;
+                this->pushed.wait(seen, std::memory_order_acquire);
+            }
+        }
+        // Moves next queued line to pending lines, false if queue is empty
+        bool pop () {
+            std::pair<int, std::string>* queued = this->queue.front();
+            if (queued == nullptr)
+                return false;
+
+            this->pending_size += queued->second.size();
+            this->pending.push_back(std::move(*queued));
+            this->queue.pop();
+            return true;
+        }
+        // Writes all pending lines, consecutive lines of the same descriptor together
+        void write_pending () {
+            size_t index = 0;
+            while (index < this->pending.size()) {
+                int fd = this->pending[index].first;
+                this->iovs.clear();
+                for (; index < this->pending.size() && this->pending[index].first == fd; ++index) {
+                    std::string& line = this->pending[index].second;
+                    this->iovs.push_back({line.data(), line.size()});
+                }
+                write_iovs(fd);
+            }
+            TraceClass::record(T_WRITE, 0, 0, static_cast<uint32_t>(this->pending.size()));
+            this->pending.clear();
+            this->pending_size = 0;
+        }
+        void write_iovs (int fd) {
+            size_t first = 0;
+            while (first < this->iovs.size()) {
+                ssize_t written = writev(fd, &this->iovs[first], static_cast<int>(std::min<size_t>(this->iovs.size() - first, IOV_MAX)));
+                if (written < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return; // Output is closed, nothing else to do
+                }
+                // Skip fully written lines, continue from the middle of partially written one
+                while (first < this->iovs.size() && static_cast<size_t>(written) >= this->iovs[first].iov_len) {
+                    written -= this->iovs[first].iov_len;
+                    ++first;
+                }
+                if (first < this->iovs.size()) {
+                    this->iovs[first].iov_base = static_cast<char*>(this->iovs[first].iov_base) + written;
+                    this->iovs[first].iov_len -= written;
+                }
+            }
+        }
+
+        MPSCQueueClass<std::pair<int, std::string>, 4096> queue;
+        std::atomic<FLUSH_POLICY> policy;
+        std::atomic<size_t> policy_value;
+        std::atomic<uint32_t> pushed;
+        std::atomic<bool> stopping;
+        std::thread writer;
+        // Lines taken from queue but not written yet, used by writer thread only
+        std::vector<std::pair<int, std::string>> pending;
+        size_t pending_size;
+        std::vector<struct iovec> iovs;
+};
+
+#endif // WRITERCLASS_H
\ No newline at end of file
@@ -0,0 +1,487 @@
+#include "UDPClass.h"
+#include "TCPClass.h"
+#include "BenchClass.h"
+
+#include <random>
+#include <regex>
+#include <sstream>
+
+// Count every heap allocation made by measured code. Replacements pair malloc with free themselves,
+// GCC only sees free of pointer returned by operator new once they get inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void* operator new (size_t size) {
+    bench_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete (void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete (void* memory, size_t size) noexcept {
+    (void)size;
+    std::free(memory);
+}
+#pragma GCC diagnostic pop
+
+// Number of generated messages of each size distribution, one pass goes over all of them
+#define BENCH_INPUTS 1024
+// Number of msg_ids duplicate filter goes through before its cost is measured again
+#define DUPFILTER_STREAM 10000000
+
+// MSG contents following one size distribution and everything codecs work on, prepared before measuring
+typedef struct {
+    std::string name;
+    std::vector<std::string> display_names;
+    std::vector<std::string> contents;
+    // Lines of user input, mostly chat lines with commands among them
+    std::vector<std::string> user_lines;
+    std::vector<MessageClass> msgs;
+    std::vector<std::string> datagrams;
+    std::vector<std::string> frames;
+} BenchInputs;
+
+// TCP decoder client used before TokenizerClass, frame goes to stringstream word by word and type is matched
+// by regexes. Kept only as reference the tokenizer is measured against
+class LegacyTCPDecoderClass {
+    public:
+        typedef struct {
+            uint8_t type             = NO_TYPE;
+            bool result              = false;
+            std::string message      = "";
+            std::string display_name = "";
+        } DataStruct;
+
+        void deserialize_msg (const std::string& frame, DataStruct& out_str) {
+            split_to_vec(frame, this->line_vec, ' ');
+            out_str.type = get_msg_type(this->line_vec.at(0));
+            switch (out_str.type) {
+                case REPLY: // REPLY OK/NOK IS {MessageContent}
+                    if (this->line_vec.size() < 3)
+                        throw std::logic_error("Unsufficient lenght of REPLY message received");
+                    out_str.result = std::regex_match(this->line_vec.at(1), std::regex("^OK$", std::regex_constants::icase));
+                    out_str.message = load_rest(3);
+                    break;
+                case MSG: // MSG FROM {DisplayName} IS {MessageContent}
+                case ERR: // ERROR FROM {DisplayName} IS {MessageContent}
+                    if (this->line_vec.size() < 4)
+                        throw std::logic_error("Unsufficient lenght of message received");
+                    out_str.display_name = this->line_vec.at(2);
+                    out_str.message = load_rest(4);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+    private:
+        std::vector<std::string> line_vec;
+
+        static MSG_TYPE get_msg_type (const std::string& first_msg_word) {
+            if (std::regex_match(first_msg_word, std::regex("^REPLY$", std::regex_constants::icase)))
+                return REPLY;
+            if (std::regex_match(first_msg_word, std::regex("^AUTH$", std::regex_constants::icase)))
+                return AUTH;
+            if (std::regex_match(first_msg_word, std::regex("^JOIN$", std::regex_constants::icase)))
+                return JOIN;
+            if (std::regex_match(first_msg_word, std::regex("^MSG$", std::regex_constants::icase)))
+                return MSG;
+            if (std::regex_match(first_msg_word, std::regex("^ERR$", std::regex_constants::icase)))
+                return ERR;
+            if (std::regex_match(first_msg_word, std::regex("^BYE$", std::regex_constants::icase)))
+                return BYE;
+            return NO_TYPE;
+        }
+        static void split_to_vec (const std::string& line, std::vector<std::string>& words_vec, char delim) {
+            words_vec.clear();
+            std::stringstream ss(line);
+            std::string line_word;
+            while (getline(ss, line_word, delim))
+                words_vec.push_back(line_word);
+        }
+        std::string load_rest (size_t start_from) {
+            std::string out = "";
+            for (size_t start_ind = start_from; start_ind < this->line_vec.size(); ++start_ind) {
+                if (start_ind != start_from)
+                    out += " ";
+                out += this->line_vec.at(start_ind);
+            }
+            return out;
+        }
+};
+
+// Codec cases measured over each size distribution, friend of both clients to reach their private codecs and send path
+class CodecBenchClass {
+    public:
+        CodecBenchClass (BenchClass& bench)
+        : bench (bench),
+          udp   (std::map<std::string, std::string>{{"ipaddr", "127.0.0.1"}}),
+          tcp   (std::map<std::string, std::string>{{"ipaddr", "127.0.0.1"}})
+        {
+        }
+
+        void run (const BenchInputs& inputs) {
+            char buffer[MAXLENGTH];
+            // Messages are only read by serializers, copy keeps inputs const
+            std::vector<MessageClass> msgs = inputs.msgs;
+
+            this->bench.run("udp_serialize/" + inputs.name, BENCH_INPUTS, total_size(inputs.datagrams), [&](size_t index) {
+                size_t out_size = this->udp.serialize_msg(msgs[index], buffer);
+                BenchClass::keep(out_size);
+            });
+            this->bench.run("udp_deserialize/" + inputs.name, BENCH_INPUTS, total_size(inputs.datagrams), [&](size_t index) {
+                const std::string& datagram = inputs.datagrams[index];
+                MessageClass msg(static_cast<uint8_t>(datagram[0]));
+                this->udp.deserialize_msg(msg, datagram.data(), datagram.size());
+                BenchClass::keep(msg);
+            });
+            this->bench.run("udp_get_msg_part/" + inputs.name, BENCH_INPUTS, total_size(inputs.datagrams), [&](size_t index) {
+                const std::string& datagram = inputs.datagrams[index];
+                size_t pos = sizeof(UDP_Header);
+                std::string_view display_name = this->udp.get_msg_part(datagram.data(), pos, datagram.size());
+                std::string_view content = this->udp.get_msg_part(datagram.data(), pos, datagram.size());
+                BenchClass::keep(display_name);
+                BenchClass::keep(content);
+            });
+            this->bench.run("tcp_serialize/" + inputs.name, BENCH_INPUTS, total_size(inputs.frames), [&](size_t index) {
+                size_t out_size = this->tcp.serialize_msg(msgs[index], buffer);
+                BenchClass::keep(out_size);
+            });
+            this->bench.run("tcp_deserialize/" + inputs.name, BENCH_INPUTS, total_size(inputs.frames), [&](size_t index) {
+                MessageClass msg;
+                this->tcp.deserialize_msg(inputs.frames[index], msg);
+                BenchClass::keep(msg);
+            });
+            this->bench.run("tcp_deserialize_legacy/" + inputs.name, BENCH_INPUTS, total_size(inputs.frames), [&](size_t index) {
+                LegacyTCPDecoderClass::DataStruct data;
+                this->legacy_tcp.deserialize_msg(inputs.frames[index], data);
+                BenchClass::keep(data);
+            });
+            this->bench.run("parse_user_line/" + inputs.name, BENCH_INPUTS, total_size(inputs.user_lines), [&](size_t index) {
+                UserCommand command = ClientClass::parse_user_line(inputs.user_lines[index]);
+                BenchClass::keep(command);
+            });
+            this->bench.run("validator/message/" + inputs.name, BENCH_INPUTS, total_size(inputs.contents), [&](size_t index) {
+                bool valid = ValidatorClass::message(inputs.contents[index]);
+                BenchClass::keep(valid);
+            });
+            this->bench.run("check_valid_msg/" + inputs.name, BENCH_INPUTS, total_size(inputs.contents), [&](size_t index) {
+                bool valid = this->udp.check_valid_msg(msgs[index]);
+                BenchClass::keep(valid);
+            });
+        }
+        // Steady state UDP sending, message goes through queue, send window and batch to the socket and is confirmed.
+        // Returns false if this path allocates once warmed up
+        bool run_send_path (const BenchInputs& inputs) {
+            // Datagrams go to socket nobody reads on loopback, kernel drops them once its buffer is full
+            int sink = socket(AF_INET, SOCK_DGRAM, 0);
+            struct sockaddr_in sink_addr;
+            memset(&sink_addr, 0, sizeof(sink_addr));
+            sink_addr.sin_family = AF_INET;
+            sink_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t addr_size = sizeof(sink_addr);
+            if (sink < 0 || bind(sink, reinterpret_cast<struct sockaddr*>(&sink_addr), addr_size) < 0 ||
+                getsockname(sink, reinterpret_cast<struct sockaddr*>(&sink_addr), &addr_size) < 0)
+                throw std::logic_error("Sink socket creation failed");
+
+            // Event loop engine, sending is driven from this thread
+            UDPClass sender(std::map<std::string, std::string>{
+                {"ipaddr", "127.0.0.1"}, {"port", std::to_string(ntohs(sink_addr.sin_port))}, {"engine", "epoll"}
+            });
+            sender.open_connection();
+            sender.cur_state = S_OPEN;
+            sender.display_name = "bench";
+            auto send_confirmed = [&](size_t index) {
+                sender.send_msg(inputs.contents[index]);
+                sender.send_pending();
+                sender.confirm_received(sender.in_flight.back()->msg_id);
+            };
+            this->bench.run("udp_send_confirm/" + inputs.name, BENCH_INPUTS, total_size(inputs.contents), send_confirmed);
+
+            uint64_t allocs_start = bench_allocations.load(std::memory_order_relaxed);
+            for (size_t index = 0; index < BENCH_INPUTS; ++index)
+                send_confirmed(index);
+            uint64_t allocs = bench_allocations.load(std::memory_order_relaxed) - allocs_start;
+            close(sink);
+            return allocs == 0;
+        }
+        // Composes wire forms of all messages with the codecs themselves
+        void prepare (BenchInputs& inputs) {
+            char buffer[MAXLENGTH];
+            for (size_t index = 0; index < BENCH_INPUTS; ++index) {
+                MessageClass& msg = inputs.msgs.emplace_back(MSG);
+                msg.msg_id = static_cast<uint16_t>(index);
+                msg.set(P_DISPLAY_NAME, inputs.display_names[index]);
+                msg.set(P_MESSAGE, inputs.contents[index]);
+
+                inputs.datagrams.emplace_back(buffer, this->udp.serialize_msg(msg, buffer));
+                // Frame is what TCP framer returns, without "\r\n"
+                size_t frame_size = this->tcp.serialize_msg(msg, buffer);
+                inputs.frames.emplace_back(buffer, frame_size - 2);
+            }
+        }
+
+        // Short identifier fields, values of random length up to field limit
+        void run_validators (std::mt19937& random) {
+            const std::string id_chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-";
+            auto generate = [&](size_t max_length, const std::string& chars) {
+                std::vector<std::string> values;
+                for (size_t index = 0; index < BENCH_INPUTS; ++index) {
+                    std::string& value = values.emplace_back(1 + random() % max_length, ' ');
+                    for (char& letter : value)
+                        letter = chars[random() % chars.size()];
+                }
+                return values;
+            };
+            std::vector<std::string> user_names = generate(20, id_chars);
+            std::vector<std::string> channel_ids = generate(20, id_chars + ".");
+            std::vector<std::string> secrets = generate(128, id_chars);
+            std::vector<std::string> display_names = generate(20, id_chars + "!#$%&*+/=?@^_~");
+
+            this->bench.run("validator/user_name", BENCH_INPUTS, total_size(user_names), [&](size_t index) {
+                bool valid = ValidatorClass::user_name(user_names[index]);
+                BenchClass::keep(valid);
+            });
+            this->bench.run("validator/channel_id", BENCH_INPUTS, total_size(channel_ids), [&](size_t index) {
+                bool valid = ValidatorClass::channel_id(channel_ids[index]);
+                BenchClass::keep(valid);
+            });
+            this->bench.run("validator/secret", BENCH_INPUTS, total_size(secrets), [&](size_t index) {
+                bool valid = ValidatorClass::secret(secrets[index]);
+                BenchClass::keep(valid);
+            });
+            this->bench.run("validator/display_name", BENCH_INPUTS, total_size(display_names), [&](size_t index) {
+                bool valid = ValidatorClass::display_name(display_names[index]);
+                BenchClass::keep(valid);
+            });
+        }
+
+    private:
+        BenchClass& bench;
+        UDPClass udp;
+        TCPClass tcp;
+        LegacyTCPDecoderClass legacy_tcp;
+
+        static size_t total_size (const std::vector<std::string>& values) {
+            size_t size = 0;
+            for (const std::string& value : values)
+                size += value.size();
+            return size;
+        }
+};
+
+// Queue client used before the lock-free one, every producer and the consumer take the same mutex
+template <typename T>
+class MutexQueueClass {
+    public:
+        void push (T&& item) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->items.push(std::move(item));
+        }
+        T* front () {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            return (this->items.empty() == true) ? nullptr : &this->items.front();
+        }
+        void pop () {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->items.pop();
+        }
+
+    private:
+        std::mutex mutex;
+        std::queue<T> items;
+};
+
+// Producers each push items messages at once while single consumer takes them out like sending thread does
+template <typename Queue>
+void queue_round (Queue& queue, size_t producers, size_t items) {
+    std::vector<std::jthread> threads;
+    for (size_t producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&queue, items] {
+            for (size_t item = 0; item < items; ++item)
+                queue.push(static_cast<uintptr_t>(item));
+        });
+    }
+    for (size_t received = 0; received < producers * items;) {
+        uintptr_t* item = queue.front();
+        // Sending thread would wait for notification here
+        if (item == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        BenchClass::keep(*item);
+        queue.pop();
+        ++received;
+    }
+}
+
+// Generates chat lines of words of lowercase letters, content size is drawn by given function
+template <typename SizeDraw>
+BenchInputs generate_inputs (const std::string& name, std::mt19937& random, SizeDraw draw_size) {
+    BenchInputs inputs;
+    inputs.name = name;
+    for (size_t index = 0; index < BENCH_INPUTS; ++index) {
+        inputs.display_names.push_back("user" + std::to_string(random() % 100000));
+
+        size_t size = draw_size();
+        std::string content;
+        while (content.size() < size) {
+            size_t word_size = 1 + random() % 10;
+            for (size_t letter = 0; letter < word_size; ++letter)
+                content.push_back(static_cast<char>('a' + random() % 26));
+            content.push_back(' ');
+        }
+        content.resize(size);
+        // Message cant end with space only because of cutting
+        content.back() = 'x';
+        inputs.contents.push_back(content);
+
+        // Every eighth line is a command, each kind the client parses in turn
+        const std::string& display_name = inputs.display_names.back();
+        switch (index % 32) {
+            case 0:
+                inputs.user_lines.push_back("/auth " + display_name + " secret" + std::to_string(index) + " " + display_name);
+                break;
+            case 8:
+                inputs.user_lines.push_back("/join channel" + std::to_string(index));
+                break;
+            case 16:
+                inputs.user_lines.push_back("/rename " + display_name);
+                break;
+            case 24:
+                inputs.user_lines.push_back("/help");
+                break;
+            default:
+                inputs.user_lines.push_back(content);
+                break;
+        }
+    }
+    return inputs;
+}
+
+void print_help () {
+    std::string help_text;
+    help_text += "Help text:\n";
+    help_text += "  -t for minimal time of each case [ms]\n";
+    help_text += "  -o for file to write results to [JSON object per line]\n";
+    help_text += "  -c for file with results of previous run to compare with\n";
+    help_text += "  -x for slowdown considered regression [%]";
+    OutputClass::out_line(help_text);
+}
+
+int main (int argc, char *argv[]) {
+    // Map for storing user values
+    std::map<std::string, std::string> data_map = {
+        {"time", "200"}, {"output", "bench_results.jsonl"}, {"threshold", "20"}
+    };
+
+    // Parse cli args, each flag is followed by its value
+    const std::map<std::string, std::string> flags = {
+        {"-t", "time"}, {"-o", "output"}, {"-c", "baseline"}, {"-x", "threshold"}
+    };
+    for (int index = 1; index < argc; ++index) {
+        std::string cur_val(argv[index]);
+        auto flag = flags.find(cur_val);
+        if (cur_val == std::string("-h")) {
+            // Print help to stdout and exit
+            print_help();
+            return EXIT_SUCCESS;
+        }
+        else if (flag != flags.end() && index + 1 < argc)
+            data_map[flag->second] = std::string(argv[++index]);
+        else {
+            OutputClass::out_err_intern("Unknown flag provided");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Fixed seed, every run measures the same messages
+    std::mt19937 random(2024);
+    std::vector<BenchInputs> distributions;
+    // Short chat lines
+    distributions.push_back(generate_inputs("short", random, [&] {
+        return 5 + random() % 76;
+    }));
+    // Mostly short lines with occasional paragraphs and pastes up to the protocol limit
+    distributions.push_back(generate_inputs("mixed", random, [&] {
+        size_t draw = random() % 100;
+        if (draw < 80)
+            return 5 + random() % 76;
+        if (draw < 95)
+            return 81 + random() % 320;
+        return 401 + random() % 1000;
+    }));
+    // Largest allowed content
+    distributions.push_back(generate_inputs("max", random, [] {
+        return 1400;
+    }));
+
+    BenchClass bench(std::chrono::milliseconds(std::stoul(data_map["time"])));
+    CodecBenchClass codecs(bench);
+    bool send_allocates = false;
+    for (BenchInputs& inputs : distributions) {
+        codecs.prepare(inputs);
+        codecs.run(inputs);
+        send_allocates = send_allocates || codecs.run_send_path(inputs) == false;
+    }
+    codecs.run_validators(random);
+
+    // Duplicate filter over stream of msg_ids where every third one is repeated copy of previous one.
+    // Cost has to be the same for filter cleared each pass and for one that went through many msg_id wraparounds
+    DupFilterClass dup_filter;
+    uint32_t stream_pos = 0;
+    auto filter_next = [&](size_t index) {
+        uint16_t msg_id = static_cast<uint16_t>((index % 3 == 2) ? stream_pos - 1 : stream_pos++);
+        bool duplicate = dup_filter.check_and_mark(msg_id);
+        BenchClass::keep(duplicate);
+    };
+    bench.run("dupfilter/fresh", BENCH_INPUTS, 0, [&](size_t index) {
+        if (index == 0)
+            dup_filter.clear();
+        filter_next(index);
+    });
+    for (size_t index = 0; index < DUPFILTER_STREAM; ++index)
+        filter_next(index);
+    bench.run("dupfilter/after_1e7", BENCH_INPUTS, 0, filter_next);
+
+    // Contended message queue, each producer pushes more messages than queue holds
+    SendQueueClass<uintptr_t> send_queue;
+    MutexQueueClass<uintptr_t> mutex_queue;
+    const size_t queue_items = 4 * SendQueueClass<uintptr_t>::NORMAL_SLOTS;
+    for (size_t producers : {1, 2, 4, 8}) {
+        std::string suffix = std::to_string(producers) + "_producers";
+        bench.run_rounds("send_queue/" + suffix, producers * queue_items, [&] {
+            queue_round(send_queue, producers, queue_items);
+        });
+        bench.run_rounds("mutex_queue/" + suffix, producers * queue_items, [&] {
+            queue_round(mutex_queue, producers, queue_items);
+        });
+    }
+
+    // Recording cost paid by instrumented client paths
+    bench.run("metrics_count", BENCH_INPUTS, 0, [](size_t index) {
+        MetricsClass::count(C_MSGS_SENT, index);
+    });
+    bench.run("metrics_record", BENCH_INPUTS, 0, [](size_t index) {
+        MetricsClass::record(H_QUEUE_DEPTH, index);
+    });
+    // Tracing is off unless client got -T
+    bench.run("trace_disabled", BENCH_INPUTS, 0, [](size_t index) {
+        TraceClass::record(T_SEND, static_cast<uint16_t>(index), MSG);
+    });
+
+    if (send_allocates == true) {
+        OutputClass::out_err_intern("Steady state UDP send path allocates");
+        return EXIT_FAILURE;
+    }
+    if (bench.write_results(data_map["output"]) == false) {
+        OutputClass::out_err_intern("Cannot write results");
+        return EXIT_FAILURE;
+    }
+    if (data_map.find("baseline") != data_map.end() && bench.compare(data_map["baseline"], std::stod(data_map["threshold"])) == false)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "ReflectorClass.h"
+
+#include <fstream>
+#include <sys/wait.h>
+
+// Result of single client variant
+typedef struct {
+    std::string name;
+    double elapsed_s;
+    double msgs_per_s;
+    uint64_t msgs;
+    uint64_t syscalls;
+    double syscalls_per_msg;
+} EngineResult;
+
+// Runs real client against in-process reflector with replayed script of MSGs and compares its engines.
+// Throughput is measured from client start to its exit, syscalls and messages come from its metrics dump
+class EngineBenchClass {
+    public:
+        EngineBenchClass (std::string client_path, std::string script_path, std::string metrics_path, uint64_t msgs_count)
+        : client_path  (client_path),
+          script_path  (script_path),
+          metrics_path (metrics_path),
+          msgs_count   (msgs_count)
+        {
+        }
+
+        // Writes script of AUTH followed by MSGs of given content length
+        bool write_script (size_t content_size) {
+            std::ofstream script(this->script_path, std::ios::trunc);
+            script << "/auth bench secret bench\n";
+            std::string content(content_size, 'x');
+            for (uint64_t index = 0; index < this->msgs_count; ++index)
+                script << content << '\n';
+            return script.good();
+        }
+        // Measures client started with given args, false if it failed or wrote no metrics
+        bool run (const std::string& name, const std::vector<std::string>& args, EngineResult& result) {
+            result = {name, 0, 0, 0, 0, 0};
+            // Metrics dump is appended, only this run has to be in the file
+            unlink(this->metrics_path.c_str());
+
+            auto start = std::chrono::steady_clock::now();
+            pid_t pid = fork();
+            if (pid < 0) {
+                OutputClass::out_err_intern("Starting client failed");
+                return false;
+            }
+            if (pid == 0) {
+                // Printed messages are not needed, writing them still is part of the measured client
+                int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                std::vector<std::string> client_args = {"-i", this->script_path, "-m", this->metrics_path};
+                std::vector<char*> argv = {const_cast<char*>(this->client_path.c_str())};
+                for (const std::string& arg : args)
+                    argv.push_back(const_cast<char*>(arg.c_str()));
+                for (std::string& arg : client_args)
+                    argv.push_back(arg.data());
+                argv.push_back(nullptr);
+                execv(argv[0], argv.data());
+                _exit(127);
+            }
+            int status;
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+            result.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (WIFEXITED(status) == false || WEXITSTATUS(status) != EXIT_SUCCESS) {
+                OutputClass::out_err_intern(name + ": client failed");
+                return false;
+            }
+
+            // Messages in both directions, UDP CONFIRMs included
+            std::ifstream metrics(this->metrics_path);
+            std::string dump;
+            if (std::getline(metrics, dump).fail() == true) {
+                OutputClass::out_err_intern(name + ": client wrote no metrics");
+                return false;
+            }
+            result.msgs = counter(dump, "msgs_sent") + counter(dump, "msgs_received");
+            result.syscalls = counter(dump, "send_syscalls") + counter(dump, "recv_syscalls");
+            result.msgs_per_s = this->msgs_count / result.elapsed_s;
+            result.syscalls_per_msg = (result.msgs > 0) ? static_cast<double>(result.syscalls) / result.msgs : 0;
+            return true;
+        }
+        // Outputs result of single variant
+        static void print (const EngineResult& result) {
+            char line[256];
+            snprintf(line, sizeof(line), "%-12s %8.3f s %12.1f msgs/s %10llu msgs on wire %10llu syscalls %8.3f syscalls/msg",
+                     result.name.c_str(), result.elapsed_s, result.msgs_per_s, static_cast<unsigned long long>(result.msgs),
+                     static_cast<unsigned long long>(result.syscalls), result.syscalls_per_msg);
+            OutputClass::out_line(line);
+        }
+
+    private:
+        std::string client_path;
+        std::string script_path;
+        std::string metrics_path;
+        uint64_t msgs_count;
+
+        // Value of counter in single line metrics dump, 0 if missing
+        static uint64_t counter (const std::string& dump, const std::string& name) {
+            size_t pos = dump.find("\"" + name + "\":");
+            if (pos == std::string::npos)
+                return 0;
+            return std::stoull(dump.substr(pos + name.size() + 3));
+        }
+};
+
+void print_help () {
+    std::string help_text;
+    help_text += "Help text:\n";
+    help_text += "  -c for client binary to measure\n";
+    help_text += "  -p for port of in-process reflector\n";
+    help_text += "  -n for number of MSGs sent by each variant\n";
+    help_text += "  -l for MSG content length [bytes]\n";
+    help_text += "  -w for UDP send window size [msgs]\n";
+    help_text += "  -q for most messages in progress of replayed script [msgs]";
+    OutputClass::out_line(help_text);
+}
+
+int main (int argc, char *argv[]) {
+    // Map for storing user values
+    std::map<std::string, std::string> data_map = {
+        {"client", "./ipk24chat-client"}, {"port", "4599"}, {"count", "20000"}, {"size", "64"},
+        {"window", "32"}, {"limit", "256"}
+    };
+
+    // Parse cli args, each flag is followed by its value
+    const std::map<std::string, std::string> flags = {
+        {"-c", "client"}, {"-p", "port"}, {"-n", "count"}, {"-l", "size"}, {"-w", "window"}, {"-q", "limit"}
+    };
+    for (int index = 1; index < argc; ++index) {
+        std::string cur_val(argv[index]);
+        auto flag = flags.find(cur_val);
+        if (cur_val == std::string("-h")) {
+            // Print help to stdout and exit
+            print_help();
+            return EXIT_SUCCESS;
+        }
+        else if (flag != flags.end() && index + 1 < argc)
+            data_map[flag->second] = std::string(argv[++index]);
+        else {
+            OutputClass::out_err_intern("Unknown flag provided");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Reflector serves the clients from this process, client counts only its own syscalls
+    uint16_t port = static_cast<uint16_t>(std::stoi(data_map["port"]));
+    ReflectorConfig config;
+    config.address.sin_family = AF_INET;
+    config.address.sin_port = htons(port);
+    config.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ReflectorStats stats;
+    int stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    std::unique_ptr<ReflectorWorkerClass> worker;
+    try {
+        worker = std::make_unique<ReflectorWorkerClass>(config, stats, stop_fd);
+    } catch (const std::logic_error& e) {
+        OutputClass::out_err_intern(std::string(e.what()));
+        return EXIT_FAILURE;
+    }
+    std::jthread reflector([&worker] {
+        try {
+            worker->run();
+        } catch (const std::logic_error& e) {
+            OutputClass::out_err_intern(e.what());
+        }
+    });
+
+    // Classic socket syscalls against io_uring, both on the threads engine
+    std::string window = data_map["window"];
+    const std::vector<std::pair<std::string, std::vector<std::string>>> variants = {
+        {"udp/threads", {"-t", "udp", "-w", window}},
+        {"udp/uring",   {"-t", "udp", "-w", window, "-e", "uring"}},
+        {"tcp/threads", {"-t", "tcp"}},
+        {"tcp/uring",   {"-t", "tcp", "-e", "uring"}}
+    };
+    std::string pid = std::to_string(getpid());
+    EngineBenchClass bench(data_map["client"], "/tmp/ipk24chat-enginebench-" + pid + ".txt",
+                           "/tmp/ipk24chat-enginebench-" + pid + ".jsonl", std::stoull(data_map["count"]));
+    bool passed = bench.write_script(std::stoul(data_map["size"]));
+    for (const auto& [name, variant_args] : variants) {
+        if (passed == false)
+            break;
+        std::vector<std::string> args = variant_args;
+        args.insert(args.end(), {"-s", "127.0.0.1", "-p", std::to_string(port), "-q", data_map["limit"]});
+        EngineResult result;
+        passed = bench.run(name, args, result);
+        if (passed == true)
+            EngineBenchClass::print(result);
+    }
+    unlink(("/tmp/ipk24chat-enginebench-" + pid + ".txt").c_str());
+    unlink(("/tmp/ipk24chat-enginebench-" + pid + ".jsonl").c_str());
+
+    uint64_t value = 1;
+    if (write(stop_fd, &value, sizeof(value)) < 0)
+        OutputClass::out_err_intern("Stopping reflector failed");
+    reflector.join();
+    close(stop_fd);
+    return (passed == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,243 @@
+#include "ReflectorClass.h"
+
+#include <fstream>
+#include <dirent.h>
+#include <sys/wait.h>
+
+// How long client may take to authenticate before check gives up on it
+#define IDLE_START_TIMEOUT 5000
+
+// Result of single client variant
+typedef struct {
+    std::string name;
+    uint64_t wakeups;
+    size_t threads;
+    double wakeups_per_minute;
+    double eof_exit_ms;
+    double sigint_exit_ms;
+} IdleResult;
+
+// Runs real client against in-process reflector, counts how often its threads wake up while session is idle
+// and how long client takes to exit once user input ends (EOF) or user interrupts it (SIGINT, input left open)
+class IdleCheckClass {
+    public:
+        IdleCheckClass (std::string client_path, uint16_t port, std::chrono::milliseconds idle_time)
+        : client_path (client_path),
+          port        (port),
+          idle_time   (idle_time)
+        {
+        }
+
+        // Measures client started with given args, false if it could not be driven through the session
+        bool run (const std::string& name, const std::vector<std::string>& args, IdleResult& result) {
+            result = {name, 0, 0, 0, 0, 0};
+            bool finished = session(args, true, result) && session(args, false, result);
+            if (finished == false)
+                OutputClass::out_err_intern(name + ": client did not authenticate");
+            return finished;
+        }
+        // Outputs result of single variant
+        static void print (const IdleResult& result) {
+            char line[256];
+            snprintf(line, sizeof(line), "%-14s %8llu wakeups %2zu threads %10.1f wakeups/min %10.3f ms exit after EOF %10.3f ms after SIGINT",
+                     result.name.c_str(), static_cast<unsigned long long>(result.wakeups), result.threads,
+                     result.wakeups_per_minute, result.eof_exit_ms, result.sigint_exit_ms);
+            OutputClass::out_line(line);
+        }
+
+    private:
+        std::string client_path;
+        uint16_t port;
+        std::chrono::milliseconds idle_time;
+
+        // Runs single client session, idle one is counted and ended by EOF, the other one is ended by SIGINT right away
+        bool session (const std::vector<std::string>& args, bool idle, IdleResult& result) {
+            int input_pipe[2];
+            int output_pipe[2];
+            if (pipe2(input_pipe, O_CLOEXEC) < 0 || pipe2(output_pipe, O_CLOEXEC) < 0) {
+                OutputClass::out_err_intern("Pipe creation failed");
+                return false;
+            }
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                OutputClass::out_err_intern("Starting client failed");
+                return false;
+            }
+            if (pid == 0) {
+                // Client reads commands from the check and reports REPLY on stderr, descriptors are closed by exec
+                dup2(input_pipe[0], STDIN_FILENO);
+                dup2(output_pipe[1], STDOUT_FILENO);
+                dup2(output_pipe[1], STDERR_FILENO);
+                std::vector<char*> argv = {const_cast<char*>(this->client_path.c_str())};
+                for (const std::string& arg : args)
+                    argv.push_back(const_cast<char*>(arg.c_str()));
+                argv.push_back(nullptr);
+                execv(argv[0], argv.data());
+                _exit(127);
+            }
+            close(input_pipe[0]);
+            close(output_pipe[1]);
+
+            bool authenticated = authenticate(input_pipe[1], output_pipe[0]);
+            // Let client finish whatever follows REPLY before counting starts
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (authenticated == true && idle == true) {
+                uint64_t before = count_switches(pid, result.threads);
+                std::this_thread::sleep_for(this->idle_time);
+                size_t threads;
+                result.wakeups = count_switches(pid, threads) - before;
+                result.wakeups_per_minute = result.wakeups * 60000.0 / this->idle_time.count();
+            }
+
+            // Client sends BYE and exits once server confirms it (UDP) or right away (TCP)
+            auto start = std::chrono::steady_clock::now();
+            if (idle == true)
+                close(input_pipe[1]);
+            else
+                kill(pid, SIGINT);
+            int status;
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+            double exit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            (idle == true ? result.eof_exit_ms : result.sigint_exit_ms) = exit_ms;
+            if (idle == false)
+                close(input_pipe[1]);
+            close(output_pipe[0]);
+            return authenticated;
+        }
+
+        // Sends AUTH and waits for its REPLY, false if it does not come in time
+        bool authenticate (int input_fd, int output_fd) {
+            std::string command = "/auth idle secret idle\n";
+            if (write(input_fd, command.data(), command.size()) != static_cast<ssize_t>(command.size()))
+                return false;
+
+            std::string output;
+            char buffer[MAXLENGTH];
+            struct pollfd fds[1] = {{.fd = output_fd, .events = POLLIN, .revents = 0}};
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(IDLE_START_TIMEOUT);
+            while (output.find("Success") == std::string::npos) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                if (left.count() <= 0 || poll(fds, 1, static_cast<int>(left.count())) <= 0)
+                    return false;
+                ssize_t bytes_read = read(output_fd, buffer, sizeof(buffer));
+                if (bytes_read <= 0)
+                    return false;
+                output.append(buffer, bytes_read);
+            }
+            return true;
+        }
+        // Sums context switches of all threads of process, each wakeup of sleeping thread ends with one
+        static uint64_t count_switches (pid_t pid, size_t& threads) {
+            uint64_t switches = 0;
+            threads = 0;
+            std::string task_dir = "/proc/" + std::to_string(pid) + "/task";
+            DIR* dir = opendir(task_dir.c_str());
+            if (dir == nullptr)
+                return 0;
+            while (struct dirent* entry = readdir(dir)) {
+                if (entry->d_name[0] == '.')
+                    continue;
+                std::ifstream status(task_dir + "/" + entry->d_name + "/status");
+                std::string line;
+                while (std::getline(status, line)) {
+                    if (line.starts_with("voluntary_ctxt_switches:") || line.starts_with("nonvoluntary_ctxt_switches:"))
+                        switches += std::stoull(line.substr(line.find(':') + 1));
+                }
+                ++threads;
+            }
+            closedir(dir);
+            return switches;
+        }
+};
+
+void print_help () {
+    std::string help_text;
+    help_text += "Help text:\n";
+    help_text += "  -c for client binary to check\n";
+    help_text += "  -p for port of in-process reflector\n";
+    help_text += "  -t for idle time measured in each variant [ms]\n";
+    help_text += "  -w for most wakeups per idle minute considered passing\n";
+    help_text += "  -x for longest exit after EOF or SIGINT considered passing [ms]";
+    OutputClass::out_line(help_text);
+}
+
+int main (int argc, char *argv[]) {
+    // Map for storing user values
+    std::map<std::string, std::string> data_map = {
+        {"client", "./ipk24chat-client"}, {"port", "4599"}, {"time", "60000"}, {"wakeups", "0"}, {"exit", "10"}
+    };
+
+    // Parse cli args, each flag is followed by its value
+    const std::map<std::string, std::string> flags = {
+        {"-c", "client"}, {"-p", "port"}, {"-t", "time"}, {"-w", "wakeups"}, {"-x", "exit"}
+    };
+    for (int index = 1; index < argc; ++index) {
+        std::string cur_val(argv[index]);
+        auto flag = flags.find(cur_val);
+        if (cur_val == std::string("-h")) {
+            // Print help to stdout and exit
+            print_help();
+            return EXIT_SUCCESS;
+        }
+        else if (flag != flags.end() && index + 1 < argc)
+            data_map[flag->second] = std::string(argv[++index]);
+        else {
+            OutputClass::out_err_intern("Unknown flag provided");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Reflector serves the clients from this process, so its own wakeups are not counted
+    uint16_t port = static_cast<uint16_t>(std::stoi(data_map["port"]));
+    ReflectorConfig config;
+    config.address.sin_family = AF_INET;
+    config.address.sin_port = htons(port);
+    config.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ReflectorStats stats;
+    int stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    std::unique_ptr<ReflectorWorkerClass> worker;
+    try {
+        worker = std::make_unique<ReflectorWorkerClass>(config, stats, stop_fd);
+    } catch (const std::logic_error& e) {
+        OutputClass::out_err_intern(std::string(e.what()));
+        return EXIT_FAILURE;
+    }
+    std::jthread reflector([&worker] {
+        try {
+            worker->run();
+        } catch (const std::logic_error& e) {
+            OutputClass::out_err_intern(e.what());
+        }
+    });
+
+    // Every transport with every engine
+    const std::vector<std::pair<std::string, std::vector<std::string>>> variants = {
+        {"udp/threads", {"-t", "udp"}},
+        {"tcp/threads", {"-t", "tcp"}},
+        {"udp/epoll",   {"-t", "udp", "-e", "epoll"}},
+        {"tcp/epoll",   {"-t", "tcp", "-e", "epoll"}},
+        {"udp/uring",   {"-t", "udp", "-e", "uring"}},
+        {"tcp/uring",   {"-t", "tcp", "-e", "uring"}}
+    };
+    IdleCheckClass check(data_map["client"], port, std::chrono::milliseconds(std::stoul(data_map["time"])));
+    double max_wakeups = std::stod(data_map["wakeups"]);
+    double max_exit = std::stod(data_map["exit"]);
+    bool passed = true;
+    for (const auto& [name, variant_args] : variants) {
+        std::vector<std::string> args = variant_args;
+        args.insert(args.end(), {"-s", "127.0.0.1", "-p", std::to_string(port)});
+        IdleResult result;
+        bool finished = check.run(name, args, result);
+        IdleCheckClass::print(result);
+        passed = passed && finished && result.wakeups_per_minute <= max_wakeups &&
+                 result.eof_exit_ms <= max_exit && result.sigint_exit_ms <= max_exit;
+    }
+
+    uint64_t value = 1;
+    if (write(stop_fd, &value, sizeof(value)) < 0)
+        OutputClass::out_err_intern("Stopping reflector failed");
+    reflector.join();
+    close(stop_fd);
+    return (passed == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,63 @@
+#include "LoadGenClass.h"
+
+void print_help () {
+    std::string help_text;
+    help_text += "Help text:\n";
+    help_text += "  -t to set type [tcp/udp]\n";
+    help_text += "  -s for providing IPv4 address\n";
+    help_text += "  -p for specifying port\n";
+    help_text += "  -c for number of sessions\n";
+    help_text += "  -j for number of event loop threads\n";
+    help_text += "  -n for number of MSGs sent by each session\n";
+    help_text += "  -R for MSG rate of each session [msgs/s, 0 = as fast as possible]\n";
+    help_text += "  -l for MSG content length [bytes]\n";
+    help_text += "  -T for time limit of the whole run [s]\n";
+    help_text += "  -d for UDP timeout [ms]\n";
+    help_text += "  -r for UDP retransmissions count\n";
+    help_text += "  -w for UDP send window size [msgs]\n";
+    help_text += "  -b for UDP batch size of send/receive syscalls [msgs]";
+    OutputClass::out_line(help_text);
+}
+
+int main (int argc, char *argv[]) {
+    // Map for storing user values
+    std::map<std::string, std::string> data_map;
+
+    // Parse cli args, each flag is followed by its value
+    const std::map<std::string, std::string> flags = {
+        {"-t", "type"},     {"-s", "ipaddr"},  {"-p", "port"},  {"-c", "sessions"},
+        {"-j", "threads"},  {"-n", "count"},   {"-R", "rate"},  {"-l", "size"},
+        {"-T", "limit"},    {"-d", "timeout"}, {"-r", "reconcount"},
+        {"-w", "window"},   {"-b", "batch"}
+    };
+    for (int index = 1; index < argc; ++index) {
+        std::string cur_val(argv[index]);
+        auto flag = flags.find(cur_val);
+        if (cur_val == std::string("-h")) {
+            // Print help to stdout and exit
+            print_help();
+            return EXIT_SUCCESS;
+        }
+        else if (flag != flags.end() && index + 1 < argc)
+            data_map.insert({flag->second, std::string(argv[++index])});
+        else {
+            OutputClass::out_err_intern("Unknown flag provided");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Check if compulsory user values -t and -s were given
+    if (data_map.find("type") == data_map.end() || data_map.find("ipaddr") == data_map.end()) {
+        OutputClass::out_err_intern("Compulsory values are missing");
+        return EXIT_FAILURE;
+    }
+
+    try {
+        LoadGenClass load_gen(data_map);
+        load_gen.run();
+    } catch (const std::logic_error& e) {
+        OutputClass::out_err_intern(std::string(e.what()));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,82 +1,115 @@
 #include "UDPClass.h"
 #include "TCPClass.h"
+#include "ReactorClass.h"
 
 // Global variable for chat client
 ClientClass* client = nullptr;
 // Global variable for notifying main function about EOF
-bool eof_event = false;
+std::atomic<bool> eof_event = false;
 
-void signalHandler (int sig_val) {
-    if (sig_val == SIGINT)
+// Blocks interrupt signal (CTRL+C) in calling thread, threads created afterwards inherit it. It is never handled
+// asynchronously, so it cant land on thread holding client locks. Has to be called before any thread starts
+void block_interrupt (sigset_t& signals) {
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+void handle_interrupt (std::stop_token stop, sigset_t signals) {
+    TraceClass::set_thread_name("interrupt");
+    int signal_number;
+    // Main thread wakes it with SIGINT of its own once session ended
+    while (sigwait(&signals, &signal_number) == 0 && stop.stop_requested() == false)
         client->send_priority_bye();
 }
 
 void handle_user_input () {
-    struct pollfd fds[1];
-    // Standard input (stdin)
-    fds[0].fd = 0;
-    fds[0].events = POLLIN;
-    // Mutex for conditional variable
-    std::mutex load_mutex;
-
-    // Process user input
-    std::string user_line;
-    std::vector<std::string> line_vec;
-
-    while (std::cin.eof() == false && client->stop_program() == false) {
-        int result = poll(fds, 1, /*waiting timeout [ms]*/100);
-        if (result > 0) {
-            if (fds[0].revents & (POLLIN | POLLHUP)) { // Input is available, read it
-                std::getline(std::cin, user_line);
-                // Skip empty line
-                if (user_line.empty() == true)
+    TraceClass::set_thread_name("input");
+    // Standard input (stdin) and event signaled at session end, no timeout is needed to notice either
+    struct pollfd fds[2] = {
+        {.fd = STDIN_FILENO,          .events = POLLIN, .revents = 0},
+        {.fd = client->get_stop_fd(), .events = POLLIN, .revents = 0}
+    };
+
+    // User input read from stdin, not processed yet. Read directly, so no line waits in stream buffer unseen by poll
+    std::string input_data;
+    char in_buffer[MAXLENGTH];
+    bool input_eof = false;
+
+    while (input_eof == false && client->stop_program() == false) {
+        size_t line_end = input_data.find('\n');
+        if (line_end == std::string::npos) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR)
                     continue;
+                OutputClass::out_err_intern("Error while waiting for user input");
+                break;
+            }
+            if (fds[1].revents != 0)
+                break;
+            if (fds[0].revents == 0)
+                continue;
 
-                if (user_line.c_str()[0] == '/') {
-                    // Command - load words from user input line
-                    client->split_to_vec(user_line, line_vec, ' ');
-                    if (line_vec.at(0) == std::string("/auth") && line_vec.size() == 4)
-                        client->send_auth(line_vec.at(1), line_vec.at(3), line_vec.at(2));
-                    else if (line_vec.at(0) == std::string("/join") && line_vec.size() == 2)
-                        client->send_join(line_vec.at(1));
-                    else if (line_vec.at(0) == std::string("/rename") && line_vec.size() == 2)
-                        client->send_rename(line_vec.at(1));
-                    else {
-                        if (line_vec.at(0) == std::string("/help") && line_vec.size() == 1)
-                            OutputClass::out_help_cmds();
-                        else if (std::cin.eof() == false) // Output error and continue
-                            OutputClass::out_err_intern("Unknown command or unsufficinet number of command params provided");
-                        continue;
-                    }
-                }
-                else if (std::cin.eof() == false) // Msg to send
-                    client->send_msg(user_line);
-
-                // Wait for user input being processed by client
-                std::unique_lock<std::mutex> lock(load_mutex);
-                client->get_input_cond_var().wait(lock, [] {
-                    return client->load_user_input();
-                });
-                client->set_load_user_input(false);
+            ssize_t bytes_read = read(STDIN_FILENO, in_buffer, MAXLENGTH);
+            if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR))
+                continue;
+            if (bytes_read > 0) {
+                input_data.append(in_buffer, bytes_read);
+                continue;
             }
+            // EOF (or error), last line may miss its line ending
+            input_eof = true;
+            if (input_data.empty() == true)
+                break;
+            line_end = input_data.size();
         }
+
+        std::string user_line = input_data.substr(0, line_end);
+        input_data.erase(0, line_end + 1);
+        // Wait for user input being processed by client
+        if (client->process_user_line(user_line, input_eof) == true)
+            client->wait_for_load_user_input();
     }
     // Check for EOF event
-    if (std::cin.eof() && client->stop_program() == false) {
+    if (input_eof == true && client->stop_program() == false) {
+        eof_event = true;
+        // Notify main thread
+        client->notify_main();
+    }
+}
+
+void handle_batch_input (BatchInputClass* batch, uint32_t limit) {
+    TraceClass::set_thread_name("input");
+    while (batch->done() == false && client->stop_program() == false) {
+        batch->feed(client, limit);
+        // Limit reached, wait till client sent everything passed so far
+        if (batch->done() == false)
+            client->wait_for_load_user_input();
+    }
+    // Whole input passed, end like at user EOF
+    if (client->stop_program() == false) {
         eof_event = true;
         // Notify main thread
-        client->get_cond_var().notify_one();
+        client->notify_main();
     }
 }
 
 int main (int argc, char *argv[]) {
     // Store client type given by user
     char* client_type = nullptr;
-    // Mutex for conditional variable
-    std::mutex end_mutex;
-
     // Map for storing user values
     std::map<std::string, std::string> data_map;
+    // Scripted input replacing stdin and max number of its messages outstanding at once
+    char* batch_path = nullptr;
+    long batch_limit = 256;
+
+    // SIGUSR1 is taken only by metrics thread, every other thread inherits it blocked
+    MetricsClass::block_signal();
+    // SIGINT is taken only by interrupt thread or event loop, every other thread inherits it blocked too
+    sigset_t interrupt_signals;
+    block_interrupt(interrupt_signals);
+    // Event loop engine runs user input and client on this thread
+    TraceClass::set_thread_name("main");
 
     // Parse cli args
     for (int index = 1; index < argc; ++index) {
@@ -91,6 +124,40 @@ int main (int argc, char *argv[]) {
             data_map.insert({"timeout", std::string(argv[++index])});
         else if (cur_val == std::string("-r"))
             data_map.insert({"reconcount", std::string(argv[++index])});
+        else if (cur_val == std::string("-w"))
+            data_map.insert({"window", std::string(argv[++index])});
+        else if (cur_val == std::string("-b"))
+            data_map.insert({"batch", std::string(argv[++index])});
+        else if (cur_val == std::string("-e"))
+            data_map.insert({"engine", std::string(argv[++index])});
+        else if (cur_val == std::string("-f")) {
+            if (OutputClass::set_flush_policy(std::string(argv[++index])) == false) {
+                OutputClass::out_err_intern("Invalid output flush policy");
+                return EXIT_FAILURE;
+            }
+        }
+        else if (cur_val == std::string("-o")) {
+            if (OutputClass::set_output_mode(std::string(argv[++index])) == false) {
+                OutputClass::out_err_intern("Invalid output mode");
+                return EXIT_FAILURE;
+            }
+        }
+        else if (cur_val == std::string("-m")) {
+            if (MetricsClass::set_output(std::string(argv[++index])) == false) {
+                OutputClass::out_err_intern("Invalid metrics output");
+                return EXIT_FAILURE;
+            }
+        }
+        else if (cur_val == std::string("-i"))
+            batch_path = argv[++index];
+        else if (cur_val == std::string("-q"))
+            batch_limit = std::strtol(argv[++index], nullptr, 10);
+        else if (cur_val == std::string("-T")) {
+            if (TraceClass::start(std::string(argv[++index])) == false) {
+                OutputClass::out_err_intern("Invalid trace output");
+                return EXIT_FAILURE;
+            }
+        }
         else if (cur_val == std::string("-h")) {
             // Print help to stdout and exit
             OutputClass::out_help();
@@ -108,6 +175,30 @@ int main (int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    // Window is kept in 16 bits, bigger value would silently wrap around
+    auto window = data_map.find("window");
+    if (window != data_map.end()) {
+        long window_size = std::strtol(window->second.c_str(), nullptr, 10);
+        if (window_size < 1 || window_size > UINT16_MAX) {
+            OutputClass::out_err_intern("Invalid send window size");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Limit keeps queue from filling up, full queue would block the event loop
+    if (batch_limit < 1 || batch_limit > SendQueueClass<MessageClass*>::NORMAL_SLOTS) {
+        OutputClass::out_err_intern("Invalid number of outstanding batch messages");
+        return EXIT_FAILURE;
+    }
+    BatchInputClass batch;
+    if (batch_path != nullptr && batch.load(std::string(batch_path)) == false) {
+        OutputClass::out_err_intern("Cannot read batch input file");
+        return EXIT_FAILURE;
+    }
+
+    // Dump metrics on SIGUSR1
+    MetricsClass::start_signal_dump();
+
     TCPClass tcpClient(data_map);
     UDPClass udpClient(data_map);
 
@@ -125,21 +216,40 @@ int main (int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    // Set interrput signal handling - CTRL+C
-    std::signal(SIGINT, signalHandler);
+    // Event loop engine handles user input and interrupt signal (CTRL+C) together with client on single thread
+    if (client->threaded() == false) {
+        try {
+            ReactorClass reactor(client, (batch_path != nullptr) ? &batch : nullptr, batch_limit, interrupt_signals);
+            reactor.run();
+        } catch (const std::logic_error& e) {
+            OutputClass::out_err_intern(std::string(e.what()));
+            return EXIT_FAILURE;
+        }
+        MetricsClass::dump_at_exit();
+        return EXIT_SUCCESS;
+    }
 
+    // Create thread for interrupt signal (CTRL+C)
+    std::jthread interrupt(handle_interrupt, interrupt_signals);
     // Create thread for user input
-    std::jthread user_input = std::jthread(handle_user_input);
+    std::jthread user_input = (batch_path != nullptr) ? std::jthread(handle_batch_input, &batch, batch_limit)
+                                                      : std::jthread(handle_user_input);
 
     // Wait for either user EOF or thread ENDING
-    std::unique_lock<std::mutex> lock(end_mutex);
+    std::unique_lock<std::mutex> lock(client->get_end_mutex());
     client->get_cond_var().wait(lock, [] {
         return (eof_event || client->stop_program());
     });
+    // Threads ending the session take the mutex too
+    lock.unlock();
 
     if (eof_event == true) // User EOF event
         client->send_bye();
     client->wait_for_threads();
+    // Stop waiting for interrupt signal before client goes away
+    interrupt.request_stop();
+    pthread_kill(interrupt.native_handle(), SIGINT);
+    MetricsClass::dump_at_exit();
 
     // End program
     return EXIT_SUCCESS;
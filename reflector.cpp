@@ -0,0 +1,49 @@
+#include "ReflectorClass.h"
+
+void print_help () {
+    std::string help_text;
+    help_text += "Help text:\n";
+    help_text += "  -s for IPv4 address to listen on\n";
+    help_text += "  -p for port shared by UDP and TCP\n";
+    help_text += "  -j for number of event loop threads\n";
+    help_text += "  -m to set answer to MSG [echo/sink]\n";
+    help_text += "  -R for MSG rate towards each client [msgs/s, 0 = as fast as possible]\n";
+    help_text += "  -n for number of MSGs blasted at each client after AUTH\n";
+    help_text += "  -l for blasted MSG content length [bytes]";
+    OutputClass::out_line(help_text);
+}
+
+int main (int argc, char *argv[]) {
+    // Map for storing user values
+    std::map<std::string, std::string> data_map;
+
+    // Parse cli args, each flag is followed by its value
+    const std::map<std::string, std::string> flags = {
+        {"-s", "ipaddr"},  {"-p", "port"},  {"-j", "threads"},  {"-m", "mode"},
+        {"-R", "rate"},    {"-n", "count"}, {"-l", "size"}
+    };
+    for (int index = 1; index < argc; ++index) {
+        std::string cur_val(argv[index]);
+        auto flag = flags.find(cur_val);
+        if (cur_val == std::string("-h")) {
+            // Print help to stdout and exit
+            print_help();
+            return EXIT_SUCCESS;
+        }
+        else if (flag != flags.end() && index + 1 < argc)
+            data_map.insert({flag->second, std::string(argv[++index])});
+        else {
+            OutputClass::out_err_intern("Unknown flag provided");
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        ReflectorClass reflector(data_map);
+        reflector.run();
+    } catch (const std::logic_error& e) {
+        OutputClass::out_err_intern(std::string(e.what()));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,335 @@
+#include "ConstsFile.h"
+
+#include <fstream>
+
+// Record of trace file together with thread it was recorded by
+typedef struct {
+    uint32_t thread;
+    TraceRecord record;
+} TracedEvent;
+
+// Sent message from being queued till its CONFIRM (UDP) or REPLY, zero times were not recorded
+typedef struct {
+    uint32_t thread;
+    uint16_t msg_id;
+    uint8_t type;
+    uint32_t retransmits;
+    uint64_t enqueue;
+    uint64_t first_send;
+    uint64_t last_send;
+    uint64_t confirm;
+    uint64_t reply;
+} OutgoingSpan;
+
+// Received message from socket till writer wrote it out
+typedef struct {
+    uint32_t thread;
+    uint16_t msg_id;
+    uint8_t type;
+    uint64_t receive;
+    uint64_t deserialize;
+    uint64_t output;
+    uint64_t written;
+} IncomingSpan;
+
+// Converts binary trace written by client (-T) to JSON trace event format read by chrome://tracing and Perfetto
+class TraceConvertClass {
+    public:
+        // Reads whole trace file, false if it isnt one
+        bool load (const std::string& path) {
+            std::ifstream file(path, std::ios::binary);
+            TraceHeader header;
+            if (file.read(reinterpret_cast<char*>(&header), sizeof(header)).good() == false ||
+                std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+                header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord))
+                return false;
+
+            TraceChunk chunk;
+            while (file.read(reinterpret_cast<char*>(&chunk), sizeof(chunk)).good() == true) {
+                if (chunk.thread >= this->thread_names.size()) {
+                    this->thread_names.resize(chunk.thread + 1);
+                    this->dropped.resize(chunk.thread + 1, 0);
+                }
+                this->thread_names[chunk.thread] = std::string(chunk.thread_name, strnlen(chunk.thread_name, sizeof(chunk.thread_name)));
+                this->dropped[chunk.thread] = chunk.dropped;
+
+                size_t first = this->events.size();
+                this->events.resize(first + chunk.count);
+                for (size_t index = first; index < this->events.size(); ++index) {
+                    this->events[index].thread = chunk.thread;
+                    if (file.read(reinterpret_cast<char*>(&this->events[index].record), sizeof(TraceRecord)).good() == false) {
+                        // Trace cut short, keep complete records only
+                        this->events.resize(index);
+                        break;
+                    }
+                }
+            }
+            // Chunks of different threads interleave, put everything in order of time
+            std::stable_sort(this->events.begin(), this->events.end(), [](const TracedEvent& first, const TracedEvent& second) {
+                return first.record.timestamp_ns < second.record.timestamp_ns;
+            });
+            return true;
+        }
+        // Writes JSON trace: thread names, every record as instant event and spans of sent and received messages
+        void convert (std::ostream& output) {
+            this->base = this->events.empty() ? 0 : this->events.front().record.timestamp_ns;
+            build_spans();
+
+            output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+            bool first = true;
+            auto put = [&](const std::string& event) {
+                output << (first ? "" : ",\n") << event;
+                first = false;
+            };
+
+            for (size_t thread = 0; thread < this->thread_names.size(); ++thread)
+                put("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + std::to_string(thread + 1) +
+                    ",\"args\":{\"name\":\"" + this->thread_names[thread] + "\"}}");
+
+            for (const TracedEvent& event : this->events) {
+                const TraceRecord& record = event.record;
+                // Input and writer records belong to no particular message
+                bool of_message = (record.event != T_INPUT && record.event != T_RESUME && record.event != T_WRITE);
+                std::string args = of_message ? "{\"msg_id\":" + std::to_string(record.msg_id) + ",\"type\":\"" +
+                                                type_name(record.msg_type) + "\",\"value\":" + std::to_string(record.value) + "}"
+                                              : "{\"value\":" + std::to_string(record.value) + "}";
+                put("{\"ph\":\"i\",\"s\":\"t\",\"name\":\"" + std::string(event_name(record.event)) + "\",\"pid\":1,\"tid\":" +
+                    std::to_string(event.thread + 1) + ",\"ts\":" + micros(record.timestamp_ns) + ",\"args\":" + args + "}");
+            }
+
+            for (size_t index = 0; index < this->outgoing.size(); ++index) {
+                const OutgoingSpan& span = this->outgoing[index];
+                std::string id = "out" + std::to_string(index);
+                uint64_t end = std::max({span.enqueue, span.last_send, span.confirm, span.reply});
+                std::string name = std::string(type_name(span.type)) + " " + std::to_string(span.msg_id);
+                put_span(put, "sent", id, span.thread, name, span.enqueue, end,
+                         "{\"msg_id\":" + std::to_string(span.msg_id) + ",\"retransmits\":" + std::to_string(span.retransmits) + "}");
+                put_span(put, "sent", id, span.thread, "queued", span.enqueue, span.first_send);
+                put_span(put, "sent", id, span.thread, "confirm wait", span.first_send, span.confirm);
+                put_span(put, "sent", id, span.thread, "reply wait", std::max(span.confirm, span.last_send), span.reply);
+            }
+
+            for (size_t index = 0; index < this->incoming.size(); ++index) {
+                const IncomingSpan& span = this->incoming[index];
+                std::string id = "in" + std::to_string(index);
+                uint64_t end = std::max({span.receive, span.deserialize, span.output, span.written});
+                std::string name = "in " + std::string(type_name(span.type)) + " " + std::to_string(span.msg_id);
+                put_span(put, "received", id, span.thread, name, span.receive, end, "{\"msg_id\":" + std::to_string(span.msg_id) + "}");
+                put_span(put, "received", id, span.thread, "parse", span.receive, span.deserialize);
+                put_span(put, "received", id, span.thread, "process", span.deserialize, span.output);
+                put_span(put, "received", id, span.thread, "output wait", span.output, span.written);
+            }
+
+            for (const auto& [thread, start, end] : this->input_waits)
+                put("{\"ph\":\"X\",\"name\":\"input wait\",\"pid\":1,\"tid\":" + std::to_string(thread + 1) +
+                    ",\"ts\":" + micros(start) + ",\"dur\":" + duration(start, end) + "}");
+            output << "\n]}\n";
+        }
+        // Outputs counts of converted records and records dropped by threads
+        void summary () {
+            std::string text = std::to_string(this->events.size()) + " events, " + std::to_string(this->outgoing.size()) +
+                               " sent and " + std::to_string(this->incoming.size()) + " received messages";
+            for (size_t thread = 0; thread < this->thread_names.size(); ++thread)
+                if (this->dropped[thread] > 0)
+                    text += "\n" + this->thread_names[thread] + " dropped " + std::to_string(this->dropped[thread]) + " events";
+            OutputClass::out_line(text);
+        }
+
+    private:
+        std::vector<TracedEvent> events;
+        std::vector<std::string> thread_names;
+        std::vector<uint64_t> dropped;
+        uint64_t base;
+
+        std::vector<OutgoingSpan> outgoing;
+        std::vector<IncomingSpan> incoming;
+        std::vector<std::tuple<uint32_t, uint64_t, uint64_t>> input_waits;
+
+        // Follows messages through records, sent ones by msg_id (across retransmissions), received ones
+        // by order of records of the thread that received them
+        void build_spans () {
+            std::unordered_map<uint16_t, size_t> sent_open;
+            std::vector<size_t> last_received(this->thread_names.size(), SIZE_MAX);
+            std::vector<uint64_t> writes;
+            uint64_t input_start = 0;
+            uint32_t input_thread = 0;
+
+            for (const TracedEvent& event : this->events) {
+                const TraceRecord& record = event.record;
+                auto sent = sent_open.find(record.msg_id);
+                OutgoingSpan* sent_span = (sent != sent_open.end()) ? &this->outgoing[sent->second] : nullptr;
+                switch (record.event) {
+                    case T_INPUT:
+                        input_start = record.timestamp_ns;
+                        input_thread = event.thread;
+                        break;
+                    case T_RESUME:
+                        if (input_start != 0)
+                            this->input_waits.emplace_back(input_thread, input_start, record.timestamp_ns);
+                        input_start = 0;
+                        break;
+                    case T_ENQUEUE:
+                        sent_open[record.msg_id] = this->outgoing.size();
+                        this->outgoing.push_back({event.thread, record.msg_id, record.msg_type, 0, record.timestamp_ns, 0, 0, 0, 0});
+                        break;
+                    case T_RETRANSMIT: {
+                        auto previous = sent_open.find(static_cast<uint16_t>(record.value));
+                        if (previous != sent_open.end()) {
+                            this->outgoing[previous->second].retransmits += 1;
+                            sent_open[record.msg_id] = previous->second;
+                        }
+                        break;
+                    }
+                    case T_SEND:
+                        if (record.msg_type != CONFIRM && sent_span != nullptr) {
+                            if (sent_span->first_send == 0)
+                                sent_span->first_send = record.timestamp_ns;
+                            sent_span->last_send = record.timestamp_ns;
+                        }
+                        break;
+                    case T_CONFIRM:
+                        if (sent_span != nullptr && sent_span->confirm == 0)
+                            sent_span->confirm = record.timestamp_ns;
+                        break;
+                    case T_REPLY:
+                        if (sent_span != nullptr && sent_span->reply == 0)
+                            sent_span->reply = record.timestamp_ns;
+                        break;
+                    case T_RECEIVE:
+                        last_received[event.thread] = this->incoming.size();
+                        this->incoming.push_back({event.thread, record.msg_id, record.msg_type, record.timestamp_ns, 0, 0, 0});
+                        break;
+                    case T_DESERIALIZE:
+                        if (last_received[event.thread] != SIZE_MAX) {
+                            this->incoming[last_received[event.thread]].deserialize = record.timestamp_ns;
+                            this->incoming[last_received[event.thread]].type = record.msg_type;
+                        }
+                        break;
+                    case T_OUTPUT:
+                        if (last_received[event.thread] != SIZE_MAX && this->incoming[last_received[event.thread]].output == 0)
+                            this->incoming[last_received[event.thread]].output = record.timestamp_ns;
+                        break;
+                    case T_WRITE:
+                        writes.push_back(record.timestamp_ns);
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            // Line is written by the first write of writer after it was handed over
+            for (IncomingSpan& span : this->incoming) {
+                if (span.output == 0)
+                    continue;
+                auto write = std::lower_bound(writes.begin(), writes.end(), span.output);
+                if (write != writes.end())
+                    span.written = *write;
+            }
+        }
+        // Puts nested async begin and end event pair, nothing if either time wasnt recorded
+        template <typename Put>
+        void put_span (Put& put, const std::string& category, const std::string& id, uint32_t thread, const std::string& name,
+                       uint64_t start, uint64_t end, const std::string& args = "{}") {
+            if (start == 0 || end == 0 || end < start)
+                return;
+            std::string common = "\"cat\":\"" + category + "\",\"id\":\"" + id + "\",\"name\":\"" + name +
+                                 "\",\"pid\":1,\"tid\":" + std::to_string(thread + 1);
+            put("{\"ph\":\"b\"," + common + ",\"ts\":" + micros(start) + ",\"args\":" + args + "}");
+            put("{\"ph\":\"e\"," + common + ",\"ts\":" + micros(end) + "}");
+        }
+        // Trace event format counts time in microseconds
+        std::string micros (uint64_t timestamp_ns) {
+            return duration(this->base, timestamp_ns);
+        }
+        static std::string duration (uint64_t start, uint64_t end) {
+            char text[32];
+            snprintf(text, sizeof(text), "%.3f", (end - start) / 1000.0);
+            return text;
+        }
+        static const char* event_name (uint8_t event) {
+            switch (event) {
+                case T_INPUT:       return "input";
+                case T_RESUME:      return "resume";
+                case T_ENQUEUE:     return "enqueue";
+                case T_SEND:        return "send";
+                case T_RETRANSMIT:  return "retransmit";
+                case T_CONFIRM:     return "confirm";
+                case T_REPLY:       return "reply";
+                case T_RECEIVE:     return "receive";
+                case T_DESERIALIZE: return "deserialize";
+                case T_OUTPUT:      return "output";
+                case T_WRITE:       return "write";
+                default:            return "unknown";
+            }
+        }
+        static const char* type_name (uint8_t type) {
+            switch (type) {
+                case CONFIRM:        return "CONFIRM";
+                case REPLY:          return "REPLY";
+                case AUTH:           return "AUTH";
+                case JOIN:           return "JOIN";
+                case MSG:            return "MSG";
+                case ERR:            return "ERR";
+                case BYE:            return "BYE";
+                case E_INTERNAL_ERR: return "INTERNAL_ERR";
+                default:             return "-";
+            }
+        }
+};
+
+void print_help () {
+    std::string help_text;
+    help_text += "Help text:\n";
+    help_text += "  -i for trace file written by client (-T)\n";
+    help_text += "  -o for output file [JSON trace events, stdout by default]";
+    OutputClass::out_line(help_text);
+}
+
+int main (int argc, char *argv[]) {
+    // Map for storing user values
+    std::map<std::string, std::string> data_map;
+
+    // Parse cli args, each flag is followed by its value
+    const std::map<std::string, std::string> flags = {
+        {"-i", "input"}, {"-o", "output"}
+    };
+    for (int index = 1; index < argc; ++index) {
+        std::string cur_val(argv[index]);
+        auto flag = flags.find(cur_val);
+        if (cur_val == std::string("-h")) {
+            // Print help to stdout and exit
+            print_help();
+            return EXIT_SUCCESS;
+        }
+        else if (flag != flags.end() && index + 1 < argc)
+            data_map[flag->second] = std::string(argv[++index]);
+        else {
+            OutputClass::out_err_intern("Unknown flag provided");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (data_map.find("input") == data_map.end()) {
+        OutputClass::out_err_intern("Compulsory values are missing");
+        return EXIT_FAILURE;
+    }
+
+    TraceConvertClass converter;
+    if (converter.load(data_map["input"]) == false) {
+        OutputClass::out_err_intern("Cannot read trace file");
+        return EXIT_FAILURE;
+    }
+
+    if (data_map.find("output") != data_map.end()) {
+        std::ofstream file(data_map["output"]);
+        converter.convert(file);
+        if (file.good() == false) {
+            OutputClass::out_err_intern("Cannot write output file");
+            return EXIT_FAILURE;
+        }
+        converter.summary();
+    }
+    else
+        converter.convert(std::cout);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+#include "ValidatorClass.h"
+
+#include <regex>
+#include <random>
+#include <functional>
+
+// Number of random values of each length checked for every field
+#define RANDOM_VALUES 200
+// Values up to this length (and of the limit length) get every byte value at block boundaries
+#define SWEPT_LENGTH 70
+
+// Field checked by both validators, patterns are the ones client used before ValidatorClass
+typedef struct {
+    std::string name;
+    std::regex pattern;
+    std::function<bool (std::string_view)> validator;
+    size_t max_length;
+    // Characters accepted by the field, random values are drawn mostly from them
+    std::string alphabet;
+} CheckedField;
+
+// Compares ValidatorClass with regex patterns it replaced on values around every length limit and SIMD block
+// boundary, every byte value is tried at positions where blocks meet
+class ValidatorCheckClass {
+    public:
+        ValidatorCheckClass (uint32_t seed)
+        : random     (seed),
+          cases      (0),
+          mismatches (0)
+        {
+        }
+
+        // Returns false if validators disagreed on some value
+        bool run (const CheckedField& field) {
+            this->cases = 0;
+            this->mismatches = 0;
+            compare(field, "");
+            for (size_t length : lengths(field.max_length)) {
+                std::string valid = random_value(field.alphabet, length, 0);
+                // Matching long value by regex is slow, every byte is tried only in short values and at the limit
+                for (size_t position : positions(length)) {
+                    if (length > SWEPT_LENGTH && length != field.max_length)
+                        break;
+                    std::string value = valid;
+                    for (int byte = 0; byte < 256; ++byte) {
+                        value[position] = static_cast<char>(byte);
+                        compare(field, value);
+                    }
+                }
+                // Mostly valid values, some with invalid bytes anywhere
+                for (size_t index = 0; index < RANDOM_VALUES; ++index)
+                    compare(field, random_value(field.alphabet, length, index % 4));
+            }
+
+            char line[128];
+            snprintf(line, sizeof(line), "%-14s %10llu cases %6llu mismatches", field.name.c_str(),
+                     static_cast<unsigned long long>(this->cases), static_cast<unsigned long long>(this->mismatches));
+            OutputClass::out_line(line);
+            return this->mismatches == 0;
+        }
+
+    private:
+        std::mt19937 random;
+        uint64_t cases;
+        uint64_t mismatches;
+
+        void compare (const CheckedField& field, const std::string& value) {
+            ++this->cases;
+            bool expected = std::regex_match(value, field.pattern);
+            if (field.validator(value) == expected)
+                return;
+            // Only first few mismatches of each field are printed
+            if (++this->mismatches <= 5) {
+                std::string hex;
+                char byte_hex[4];
+                for (unsigned char byte : value) {
+                    snprintf(byte_hex, sizeof(byte_hex), "%02x", byte);
+                    hex += byte_hex;
+                }
+                OutputClass::out_err_intern(field.name + " (regex " + (expected ? "accepts" : "rejects") + "): " + hex);
+            }
+        }
+        // Lengths around both SIMD block sizes and the field limit
+        static std::vector<size_t> lengths (size_t max_length) {
+            std::vector<size_t> values;
+            for (size_t length = 1; length <= std::min<size_t>(max_length + 1, SWEPT_LENGTH); ++length)
+                values.push_back(length);
+            for (size_t length : {95, 96, 97, 127, 128, 129, 255, 256, 257, 1023, 1024, 1025})
+                if (length > SWEPT_LENGTH && length <= max_length + 1)
+                    values.push_back(length);
+            if (max_length + 1 > SWEPT_LENGTH)
+                for (size_t length = max_length - 33; length <= max_length + 1; ++length)
+                    if (length > 1025)
+                        values.push_back(length);
+            return values;
+        }
+        // Both ends of the value and both sides of every 16 byte boundary among first 64 bytes and last 33 bytes
+        static std::vector<size_t> positions (size_t length) {
+            std::vector<size_t> values;
+            for (size_t position = 0; position < length; ++position) {
+                size_t from_end = length - 1 - position;
+                if (position % 16 == 0 || position % 16 == 15 || (position < 64 && position % 8 == 0) || from_end < 2 ||
+                    (from_end < 33 && from_end % 16 == 0))
+                    values.push_back(position);
+            }
+            return values;
+        }
+        // Draws value from alphabet, each invalid_rate-th byte (if any) is drawn from all byte values
+        std::string random_value (const std::string& alphabet, size_t length, size_t invalid_rate) {
+            std::string value(length, '\0');
+            for (char& byte : value) {
+                if (invalid_rate != 0 && this->random() % (invalid_rate * 16) == 0)
+                    byte = static_cast<char>(this->random() % 256);
+                else
+                    byte = alphabet[this->random() % alphabet.size()];
+            }
+            return value;
+        }
+};
+
+// Returns all characters in given inclusive range
+std::string char_range (char low, char high) {
+    std::string chars;
+    for (char letter = low; letter <= high; ++letter)
+        chars.push_back(letter);
+    return chars;
+}
+
+void print_help () {
+    std::string help_text;
+    help_text += "Help text:\n";
+    help_text += "  -r for seed of random values";
+    OutputClass::out_line(help_text);
+}
+
+int main (int argc, char *argv[]) {
+    // Map for storing user values
+    std::map<std::string, std::string> data_map = {
+        {"seed", "2024"}
+    };
+
+    // Parse cli args, each flag is followed by its value
+    const std::map<std::string, std::string> flags = {
+        {"-r", "seed"}
+    };
+    for (int index = 1; index < argc; ++index) {
+        std::string cur_val(argv[index]);
+        auto flag = flags.find(cur_val);
+        if (cur_val == std::string("-h")) {
+            // Print help to stdout and exit
+            print_help();
+            return EXIT_SUCCESS;
+        }
+        else if (flag != flags.end() && index + 1 < argc)
+            data_map[flag->second] = std::string(argv[++index]);
+        else {
+            OutputClass::out_err_intern("Unknown flag provided");
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string id_chars = char_range('A', 'z') + char_range('0', '9') + "-";
+    const std::vector<CheckedField> fields = {
+        {"user_name",    std::regex("^[A-z0-9-]{1,20}$"),       ValidatorClass::user_name,    20,   id_chars},
+        {"channel_id",   std::regex("^[A-z0-9-.]{1,20}$"),      ValidatorClass::channel_id,   20,   id_chars + "."},
+        {"secret",       std::regex("^[A-z0-9-]{1,128}$"),      ValidatorClass::secret,       128,  id_chars},
+        {"display_name", std::regex("^[\x21-\x7E]{1,20}$"),     ValidatorClass::display_name, 20,   char_range('\x21', '\x7E')},
+        {"message",      std::regex("^[\x20-\x7E]{1,1400}$"),   ValidatorClass::message,      1400, char_range('\x20', '\x7E')}
+    };
+
+    ValidatorCheckClass check(static_cast<uint32_t>(std::stoul(data_map["seed"])));
+    bool passed = true;
+    for (const CheckedField& field : fields)
+        passed = check.run(field) && passed;
+    return (passed == true) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file